@@ -0,0 +1,441 @@
+//
+//  browseGrid.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/21/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "browseGrid.hpp"
+#include "feedService.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+extern const std::string kTextureKeyLoadingIcon;
+extern const std::string kTextureKeyLinkError;
+
+static const std::string kNoGamesKey = "grid-no-games";
+static const std::string kNoGamesValue = "No games";
+
+static const double kLoadingRotationRate = 360;
+// Seconds before a row whose feed failed is fetched again, doubling with each failure
+static const double kRetryDelay = 2;
+static const double kMaxRetryDelay = 60;
+// Seconds between looking for a stale feed, which takes the feed service's lock. Feeds go stale over minutes
+static const double kStaleCheckInterval = 1;
+
+BrowseGrid::BrowseGrid(BrowseGridConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, bool verbose) : verbose_(verbose), config_(config), loadingRotate_(0), time_(0), staleCheckAt_(kStaleCheckInterval), textureService_(texService), fontTextService_(fontTextService), feedService_(feedService) {
+
+    backingW_ = config.tileWidth + config.frameOffset * 2;
+    backingH_ = config.tileHeight + config.frameOffset * 2;
+    rowPitch_ = config.labelHeight + backingH_ + config.rowSpacing;
+    columnPitch_ = backingW_ + config.tileSpacing;
+
+    numRows_ = static_cast<int32_t>(feedService_->getNumDates());
+    row_ = feedService_->getDefaultDateIndex();
+    y_ = getTargetY();
+
+    loadingIconTex_ = textureService_->getTexture(kTextureKeyLoadingIcon);
+    linkErrorTex_ = textureService_->getTexture(kTextureKeyLinkError);
+    noGamesTex_ = fontTextService_->addString(FontTextService::Font::Roboto36, kNoGamesKey, kNoGamesValue, { 0xA0, 0xA0, 0xA0, 0xFF });
+}
+
+BrowseGrid::~BrowseGrid() {
+    releaseText();
+    for (auto& row : rows_) {
+        releaseRow(row.second);
+    }
+    rows_.clear();
+
+    // Remove what we've created
+    fontTextService_->removeString(kNoGamesKey);
+}
+
+size_t BrowseGrid::getMaxLiveRows(const BrowseGridConfig& config) {
+    auto rowPitch = config.labelHeight + config.tileHeight + config.frameOffset * 2 + config.rowSpacing;
+    // One more for the row partly scrolled in at each edge
+    return static_cast<size_t>(config.height / rowPitch + 2 + config.marginRows * 2);
+}
+
+void BrowseGrid::update(double deltaTime, DisplayList *displaylist, const Input& input) {
+    time_ += deltaTime;
+    // As the date selector, only the focused row is kept fresh
+    if (time_ >= staleCheckAt_) {
+        staleCheckAt_ = time_ + kStaleCheckInterval;
+        feedService_->refreshIfStale(feedService_->getDateAtIndex(row_));
+    }
+    handleInput(input);
+
+    auto distance = static_cast<double>(config_.scrollRate) * deltaTime;
+    scrollTowards(y_, getTargetY(), distance);
+
+    loadingRotate_ += kLoadingRotationRate * deltaTime;
+    while (loadingRotate_ > 360) {
+        loadingRotate_ -= 360;
+    }
+
+    updateLiveRows();
+    int32_t firstVisible, lastVisible;
+    getVisibleRows(firstVisible, lastVisible);
+    for (auto& it : rows_) {
+        auto& row = it.second;
+        syncFeed(row);
+        scrollTowards(row.x, getTargetX(row), distance);
+        updateLiveTiles(row, it.first >= firstVisible && it.first < lastVisible);
+    }
+    updateText();
+
+    draw(displaylist);
+}
+
+void BrowseGrid::handleInput(const Input& input) {
+    // Like the carousel, moves are only taken once the last one has finished scrolling
+    if (y_ != getTargetY()) {
+        return;
+    }
+    auto it = rows_.find(row_);
+    if (it != rows_.end() && it->second.x != getTargetX(it->second)) {
+        return;
+    }
+
+    if (input.down && row_ + 1 < numRows_) {
+        ++row_;
+        feedService_->pinFeed(feedService_->getDateAtIndex(row_));
+    } else if (input.up && row_ > 0) {
+        --row_;
+        feedService_->pinFeed(feedService_->getDateAtIndex(row_));
+    } else if (it != rows_.end()) {
+        auto& row = it->second;
+        if (input.right && row.column + 1 < static_cast<int32_t>(row.tiles.size())) {
+            ++row.column;
+        } else if (input.left && row.column > 0) {
+            --row.column;
+        }
+    }
+}
+
+void BrowseGrid::updateLiveRows() {
+    int32_t firstVisible, lastVisible;
+    getVisibleRows(firstVisible, lastVisible);
+    // The focused row is always live, even while it is still scrolling into view
+    auto first = std::max(std::min(firstVisible, row_) - config_.marginRows, 0);
+    auto last = std::min(std::max(lastVisible, row_ + 1) + config_.marginRows, numRows_);
+
+    for (auto it=rows_.begin();it!=rows_.end();) {
+        if (it->first < first || it->first >= last) {
+            releaseRow(it->second);
+            it = rows_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Rows still needing a feed are fetched in runs of consecutive dates, which FeedService turns into ranged
+    // requests. Runs are split where visibility changes so the rows on screen go out first
+    int32_t runStart = -1;
+    bool runVisible = false;
+    std::vector<std::shared_ptr<RowFetch>> runFetches;
+    auto flushRun = [&](int32_t end) {
+        if (runStart >= 0) {
+            auto startDate = feedService_->getDateAtIndex(runStart);
+            auto endDate = feedService_->getDateAtIndex(end - 1);
+            if (verbose_) {
+                Log(LogLevel::Debug) << "Grid fetching " << startDate << " to " << endDate;
+            }
+            // Callbacks don't say which date they are for, so a failure marks the whole run. Dates which did arrive
+            // are picked up by syncFeed regardless, and retrying one still in flight joins its request
+            auto fetches = std::move(runFetches);
+            runFetches.clear();
+            feedService_->fetchFeeds(startDate, endDate, [fetches](Error error, uint32_t status, std::shared_ptr<Feed> feed) {
+                if (error != Error::None && !feed) {
+                    for (auto& fetch : fetches) {
+                        fetch->failed = true;
+                    }
+                }
+            }, runVisible ? FetchPriority::High : FetchPriority::Normal);
+            runStart = -1;
+        }
+    };
+    for (int32_t i=first;i<last;++i) {
+        auto& row = rows_[i];
+        if (row.date.empty()) {
+            row.date = feedService_->getDateAtIndex(i);
+            row.label = fontTextService_->addString(FontTextService::Font::Roboto36, row.date, { 0xFF, 0xFF, 0xFF, 0xFF });
+            row.labelTex = textureService_->getTexture(row.label);
+        }
+        if (row.requested && !row.feed && row.fetch && row.fetch->failed) {
+            row.requested = false;
+            row.retryAt = time_ + std::min(kRetryDelay * (1 << std::min(row.failures, 5)), kMaxRetryDelay);
+            ++row.failures;
+        }
+        bool visible = i >= firstVisible && i < lastVisible;
+        bool needed = !row.requested && !row.feed && time_ >= row.retryAt;
+        if (!needed || visible != runVisible) {
+            flushRun(i);
+        }
+        if (needed) {
+            row.requested = true;
+            row.fetch = std::make_shared<RowFetch>();
+            runFetches.push_back(row.fetch);
+            if (runStart < 0) {
+                runStart = i;
+                runVisible = visible;
+            }
+        }
+    }
+    flushRun(last);
+}
+
+void BrowseGrid::releaseRow(Row& row) {
+    if (textFeed_ && textFeed_ == row.feed) {
+        releaseText();
+    }
+    releaseTiles(row);
+    row.feed = nullptr;
+    fontTextService_->removeString(row.label);
+    row.labelTex = nullptr;
+}
+
+void BrowseGrid::syncFeed(Row& row) {
+    auto feed = feedService_->getFeed(row.date);
+    if (feed != row.feed) {
+        if (textFeed_ && textFeed_ == row.feed) {
+            releaseText();
+        }
+        releaseTiles(row);
+        row.tiles.clear();
+        row.feed = feed;
+        if (!feed) {
+            // Evicted, fetch it again
+            row.requested = false;
+            return;
+        }
+        row.failures = 0;
+        row.retryAt = 0;
+        // Version first, so a patch made while we're reading is picked up next update
+        row.feedVersion = feed->getVersion();
+        for (auto& recap : feed->getRecaps()) {
+            row.tiles.push_back(Tile{recap, nullptr, false});
+        }
+        row.column = std::min(row.column, std::max(static_cast<int32_t>(row.tiles.size()) - 1, 0));
+        row.x = getTargetX(row);
+        row.firstLive = row.lastLive = 0;
+    } else if (feed && feed->getVersion() != row.feedVersion) {
+        row.feedVersion = feed->getVersion();
+
+        // Unchanged games keep the same recap and with it the thumbnail we acquired. Those of replaced recaps have
+        // already been released by FeedService
+        std::unordered_map<FeedGameRecap *, size_t> previous;
+        for (size_t i=0;i<row.tiles.size();++i) {
+            previous[row.tiles[i].recap.get()] = i;
+        }
+        uint32_t currPark = row.column < static_cast<int32_t>(row.tiles.size()) ? row.tiles[row.column].recap->park : 0;
+
+        std::vector<Tile> tiles;
+        int32_t firstLive = 0;
+        int32_t lastLive = 0;
+        for (auto& recap : feed->getRecaps()) {
+            auto it = previous.find(recap.get());
+            if (it != previous.end()) {
+                tiles.push_back(row.tiles[it->second]);
+            } else {
+                tiles.push_back(Tile{recap, nullptr, false});
+            }
+            if (tiles.back().live) {
+                // The live tiles may have moved, cover all of them so the next updateLiveTiles can release the strays
+                int32_t index = static_cast<int32_t>(tiles.size()) - 1;
+                firstLive = lastLive == 0 ? index : firstLive;
+                lastLive = index + 1;
+            }
+        }
+        bool hasText = std::any_of(tiles.begin(), tiles.end(), [this](const Tile& tile) { return tile.recap == textRecap_; });
+        if (textRecap_ && previous.count(textRecap_.get()) && !hasText) {
+            // Its text went with it
+            textFeed_ = nullptr;
+            textRecap_ = nullptr;
+            headlineTex_ = nullptr;
+        }
+        row.tiles = std::move(tiles);
+        row.firstLive = firstLive;
+        row.lastLive = lastLive;
+
+        // Stay on the same game if it is still there
+        row.column = std::min(row.column, std::max(static_cast<int32_t>(row.tiles.size()) - 1, 0));
+        for (int32_t i=0;i<static_cast<int32_t>(row.tiles.size());++i) {
+            if (row.tiles[i].recap->park == currPark) {
+                row.column = i;
+                break;
+            }
+        }
+        row.x = getTargetX(row);
+    }
+}
+
+void BrowseGrid::releaseTiles(Row& row) {
+    for (auto i=row.firstLive;i<row.lastLive;++i) {
+        auto& tile = row.tiles[i];
+        if (tile.live) {
+            feedService_->releaseThumbnail(row.feed, tile.recap);
+            tile.thumb = nullptr;
+            tile.live = false;
+        }
+    }
+    row.firstLive = row.lastLive = 0;
+}
+
+void BrowseGrid::updateLiveTiles(Row& row, bool rowVisible) {
+    if (!row.feed) {
+        return;
+    }
+    int32_t firstVisible, lastVisible;
+    getVisibleColumns(row, firstVisible, lastVisible);
+    auto numTiles = static_cast<int32_t>(row.tiles.size());
+    auto first = std::max(firstVisible - config_.marginColumns, 0);
+    auto last = std::min(lastVisible + config_.marginColumns, numTiles);
+
+    for (auto i=row.firstLive;i<row.lastLive;++i) {
+        auto& tile = row.tiles[i];
+        if ((i < first || i >= last) && tile.live) {
+            feedService_->releaseThumbnail(row.feed, tile.recap);
+            tile.thumb = nullptr;
+            tile.live = false;
+        }
+    }
+    // Walked every frame rather than only when the window moves, since a refresh can replace tiles inside it
+    for (auto i=first;i<last;++i) {
+        auto& tile = row.tiles[i];
+        if (!tile.live) {
+            bool visible = rowVisible && i >= firstVisible && i < lastVisible;
+            feedService_->acquireThumbnail(row.feed, tile.recap, visible ? FetchPriority::High : FetchPriority::Normal);
+            tile.live = true;
+        }
+    }
+    row.firstLive = first;
+    row.lastLive = last;
+}
+
+void BrowseGrid::updateText() {
+    auto it = rows_.find(row_);
+    if (it == rows_.end() || it->second.column >= static_cast<int32_t>(it->second.tiles.size())) {
+        releaseText();
+        return;
+    }
+    auto& row = it->second;
+    auto& recap = row.tiles[row.column].recap;
+    if (recap != textRecap_) {
+        releaseText();
+        auto text = feedService_->acquireRecapText(row.feed, recap);
+        textFeed_ = row.feed;
+        textRecap_ = recap;
+        headlineTex_ = text.headline;
+    }
+}
+
+void BrowseGrid::releaseText() {
+    if (textFeed_ && textRecap_) {
+        feedService_->releaseRecapText(textFeed_, textRecap_);
+    }
+    textFeed_ = nullptr;
+    textRecap_ = nullptr;
+    headlineTex_ = nullptr;
+}
+
+void BrowseGrid::draw(DisplayList *displaylist) {
+    int32_t firstRow, lastRow;
+    getVisibleRows(firstRow, lastRow);
+    for (auto r=firstRow;r<lastRow;++r) {
+        auto it = rows_.find(r);
+        if (it == rows_.end()) {
+            continue;
+        }
+        auto& row = it->second;
+        double top = config_.top + static_cast<double>(r) * rowPitch_ - y_;
+        double labelY = top + config_.labelHeight / 2;
+        double tileY = top + config_.labelHeight + backingH_ / 2;
+
+        double labelRight = config_.left + config_.frameOffset;
+        if (row.labelTex) {
+            displaylist->addTexture(row.labelTex, labelRight + row.labelTex->getWidth() / 2, labelY);
+            labelRight += row.labelTex->getWidth();
+        }
+        if (r == row_ && headlineTex_) {
+            displaylist->addTexture(headlineTex_, labelRight + config_.tileSpacing + headlineTex_->getWidth() / 2, labelY);
+        }
+
+        if (!row.feed) {
+            // Still showing the error while the retry is out
+            if (row.failures) {
+                displaylist->addTexture(linkErrorTex_, config_.left + backingW_ / 2, tileY);
+            } else {
+                displaylist->addXformTexture(loadingIconTex_, config_.left + backingW_ / 2, tileY, loadingRotate_, 1, 1);
+            }
+            continue;
+        }
+        if (row.tiles.empty()) {
+            displaylist->addTexture(noGamesTex_, config_.left + config_.frameOffset + noGamesTex_->getWidth() / 2, tileY);
+            continue;
+        }
+
+        int32_t firstColumn, lastColumn;
+        getVisibleColumns(row, firstColumn, lastColumn);
+        for (auto c=firstColumn;c<lastColumn;++c) {
+            auto& tile = row.tiles[c];
+            double x = config_.left + static_cast<double>(c) * columnPitch_ - row.x + backingW_ / 2;
+
+            displaylist->addRect(x, tileY, backingW_, backingH_, config_.backingColor);
+            if (r == row_ && c == row.column) {
+                displaylist->addFrameRect(x, tileY, backingW_, backingH_, config_.frameColor);
+            }
+
+            auto state = tile.recap->getThumbnailState();
+            if (!tile.thumb && tile.live && state == FeedGameRecap::ThumbnailState::Loaded) {
+                tile.thumb = textureService_->getTexture(tile.recap->getThumbnail());
+            }
+            if (tile.thumb) {
+                // Cuts come in different sizes, they're all drawn at the tile's size
+                auto scaleX = static_cast<double>(config_.tileWidth) / tile.thumb->getWidth();
+                auto scaleY = static_cast<double>(config_.tileHeight) / tile.thumb->getHeight();
+                displaylist->addScaledTexture(tile.thumb, x, tileY, scaleX, scaleY);
+            } else if (state == FeedGameRecap::ThumbnailState::Error) {
+                displaylist->addTexture(linkErrorTex_, x, tileY);
+            } else {
+                displaylist->addXformTexture(loadingIconTex_, x, tileY, loadingRotate_, 1, 1);
+            }
+        }
+    }
+}
+
+void BrowseGrid::getVisibleRows(int32_t& first, int32_t& last) const {
+    first = std::max(static_cast<int32_t>(std::floor(y_ / rowPitch_)), 0);
+    last = std::min(static_cast<int32_t>(std::ceil((y_ + config_.height) / rowPitch_)), numRows_);
+}
+
+void BrowseGrid::getVisibleColumns(const Row& row, int32_t& first, int32_t& last) const {
+    first = std::max(static_cast<int32_t>(std::floor(row.x / columnPitch_)), 0);
+    last = std::min(static_cast<int32_t>(std::ceil((row.x + config_.width) / columnPitch_)), static_cast<int32_t>(row.tiles.size()));
+}
+
+double BrowseGrid::getTargetY() const {
+    // Keep the focused row in the middle of the viewport, without scrolling past either end
+    double y = static_cast<double>(row_) * rowPitch_ - (config_.height - rowPitch_) / 2;
+    double maxY = static_cast<double>(numRows_) * rowPitch_ - config_.height;
+    return std::max(std::min(y, maxY), 0.0);
+}
+
+double BrowseGrid::getTargetX(const Row& row) const {
+    // Likewise for the focused column
+    double x = static_cast<double>(row.column) * columnPitch_ - (config_.width - columnPitch_) / 2;
+    double maxX = static_cast<double>(row.tiles.size()) * columnPitch_ - config_.width;
+    return std::max(std::min(x, maxX), 0.0);
+}
+
+void BrowseGrid::scrollTowards(double& position, double target, double distance) {
+    if (position < target) {
+        position = std::min(position + distance, target);
+    } else if (position > target) {
+        position = std::max(position - distance, target);
+    }
+}
@@ -0,0 +1,145 @@
+//
+//  browseGrid.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/21/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef browseGrid_hpp
+#define browseGrid_hpp
+
+#include <stdio.h>
+#include "types.h"
+#include "feed.hpp"
+#include "input.hpp"
+#include "texture.hpp"
+#include "textureService.hpp"
+#include "fontTextService.hpp"
+#include "displayList.hpp"
+
+class FeedService;
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct BrowseGridConfig {
+    int         left;               // Viewport, in screen space
+    int         top;
+    int         width;
+    int         height;
+    int         tileWidth;
+    int         tileHeight;
+    int         tileSpacing;
+    int         labelHeight;        // Above each row's tiles, for its date and the focused game's headline
+    int         rowSpacing;
+    int         frameOffset;
+    int         marginRows;         // Rows either side of the viewport which are fetched and kept ready
+    int         marginColumns;      // Likewise for the tiles either side of a row's visible ones
+    int         scrollRate;         // Pixels per second
+    Color       backingColor;
+    Color       frameColor;
+};
+
+// One row per date in the FeedService's date index, each a horizontally scrolling strip of that date's games, with
+// vertical scrolling between rows. Virtualized in both directions: only rows within marginRows of the viewport exist,
+// have their feed fetched and their date rasterized, and within those only tiles within marginColumns of the visible
+// ones have thumbnails acquired. Only visible tiles are drawn, so the cost of a frame depends on the viewport and the
+// margins rather than on the number of dates or games. Expects FeedService thumbnails on demand
+class BrowseGrid {
+public:
+    BrowseGrid(BrowseGridConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, bool verbose);
+    ~BrowseGrid();
+
+    void update(double deltaTime, DisplayList *displaylist, const Input& input);
+
+    // Rows kept ready at most, for sizing the feed cache
+    static size_t getMaxLiveRows(const BrowseGridConfig& config);
+
+    size_t getNumLiveRows() const { return rows_.size(); }
+
+private:
+    struct Tile {
+        std::shared_ptr<FeedGameRecap>  recap;
+        std::shared_ptr<Texture>        thumb;
+        bool                            live = false;   // Thumbnail acquired
+    };
+
+    // Set by the fetch callback, which can run on a worker after the row has gone
+    struct RowFetch {
+        std::atomic<bool>           failed{false};
+    };
+
+    struct Row {
+        std::string                 date;
+        std::shared_ptr<Feed>       feed;
+        uint32_t                    feedVersion = 0;    // Version of feed tiles was built from
+        bool                        requested = false;
+        std::shared_ptr<RowFetch>   fetch;              // The latest request
+        int32_t                     failures = 0;       // Consecutive failed requests, backed off and shown as an error
+        double                      retryAt = 0;
+        TextureHandle               label;
+        std::shared_ptr<Texture>    labelTex;
+        std::vector<Tile>           tiles;
+        int32_t                     column = 0;         // Focused column
+        double                      x = 0;              // Horizontal scroll
+        int32_t                     firstLive = 0;      // Tiles in [firstLive, lastLive) have their thumbnails acquired
+        int32_t                     lastLive = 0;
+    };
+
+    bool                                verbose_;
+    BrowseGridConfig                    config_;
+    int                                 backingW_;
+    int                                 backingH_;
+    int                                 rowPitch_;
+    int                                 columnPitch_;
+    int32_t                             numRows_;
+
+    int32_t                             row_;       // Focused row, by date index
+    double                              y_;         // Vertical scroll
+    double                              loadingRotate_;
+    double                              time_;      // Seconds since we were created, for retries
+    double                              staleCheckAt_;
+
+    std::map<int32_t, Row>              rows_;      // Only the live ones, by date index
+
+    // Headline of the focused tile
+    std::shared_ptr<Feed>               textFeed_;
+    std::shared_ptr<FeedGameRecap>      textRecap_;
+    std::shared_ptr<Texture>            headlineTex_;
+
+    std::shared_ptr<TextureService>     textureService_;
+    std::shared_ptr<FontTextService>    fontTextService_;
+    std::shared_ptr<FeedService>        feedService_;
+
+    std::shared_ptr<Texture>            loadingIconTex_;
+    std::shared_ptr<Texture>            linkErrorTex_;
+    std::shared_ptr<Texture>            noGamesTex_;
+
+    void handleInput(const Input& input);
+    // Creates the rows which have come within the margin, fetching their feeds together, and releases the ones which have left it
+    void updateLiveRows();
+    void releaseRow(Row& row);
+    // Picks up the row's feed once it arrives, and rebuilds the tiles when it is patched or evicted
+    void syncFeed(Row& row);
+    void releaseTiles(Row& row);
+    // Acquires thumbnails for the tiles which have come within the margin and releases the ones which have left it.
+    // Those on screen are fetched first
+    void updateLiveTiles(Row& row, bool rowVisible);
+    void updateText();
+    void releaseText();
+    void draw(DisplayList *displaylist);
+
+    // Rows in [first, last) are at least partly inside the viewport
+    void getVisibleRows(int32_t& first, int32_t& last) const;
+    void getVisibleColumns(const Row& row, int32_t& first, int32_t& last) const;
+    double getTargetY() const;
+    double getTargetX(const Row& row) const;
+
+    static void scrollTowards(double& position, double target, double distance);
+};
+
+#endif /* browseGrid_hpp */
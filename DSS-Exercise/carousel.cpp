@@ -9,7 +9,9 @@
 #include "carousel.hpp"
 #include "feedService.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <unordered_map>
 
 extern const int32_t SCREEN_WIDTH;
 extern const int32_t SCREEN_HEIGHT;
@@ -23,8 +25,18 @@ static const std::string kLoadingFeedKey = "loading-feed";
 static const std::string kLoadingFeedValue = "LOADING...";
 
 static const double kLoadingRotationRate = 360;
+// Thumbnails within this many of the focused one have their text ready. Text is released once a thumbnail is a few
+// further away than that, so scrolling back and forth doesn't keep rasterizing the same strings
+static const int32_t kTextRadius = 2;
+static const int32_t kTextReleaseRadius = kTextRadius + 3;
+// The focused cut is kept for a neighbour or two, so stepping back doesn't fetch it again
+static const int32_t kFocusReleaseRadius = 2;
+// Seconds between asking again for a focused cut which hasn't arrived, in case it failed
+static const double kFocusRetryInterval = 2;
+// Slots beyond the edges of the screen, so thumbnails are loading before they scroll into view
+static const int32_t kSlotMargin = 3;
 
-Carousel::Carousel(CarouselConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, bool verbose) : verbose_(verbose), state_(State::Initializing), config_(config), x_(0), y_(config.y), currThumb_(0), targetThumb_(0), targetX_(0), loadingRotate_(0), textureService_(texService), fontTextService_(fontTextService)  {
+Carousel::Carousel(CarouselConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, bool verbose) : verbose_(verbose), state_(State::Initializing), config_(config), x_(0), y_(config.y), currThumb_(0), targetThumb_(0), targetX_(0), loadingRotate_(0), focusRetry_(0), firstThumb_(0), feedVersion_(0), textureService_(texService), fontTextService_(fontTextService), feedService_(feedService)  {
 
     backingW_ = config.thumbnailWidth + config.frameOffsetX * 2;
     backingH_ = config.thumbnailHeight + config.frameOffsetY * 2;
@@ -32,6 +44,9 @@ Carousel::Carousel(CarouselConfig config, const std::shared_ptr<TextureService>&
     auto minWidth = backingW_ * config.scaleDownPercentage;
     minNeighborDistance_ = minWidth + config.thumbnailBetweenSpacing;
     maxNeighborDistance_ = backingW_ / 2 + config.thumbnailBetweenSpacing + minWidth / 2;
+    // Half a screen of downscaled neighbours, one for the current thumbnail being wider and the margin. The text and
+    // focused cut radii have to fit inside it
+    slotRadius_ = std::max((SCREEN_WIDTH / 2) / minNeighborDistance_ + 1 + kSlotMargin, kTextReleaseRadius + 1);
     
     loadingIconTex_ = textureService_->getTexture(kTextureKeyLoadingIcon);
     linkErrorTex_ = textureService_->getTexture(kTextureKeyLinkError);
@@ -40,7 +55,7 @@ Carousel::Carousel(CarouselConfig config, const std::shared_ptr<TextureService>&
 }
 
 Carousel::~Carousel() {
-    thumbs_.clear();
+    releaseThumbnails();
 
     // Remove what we've created
     fontTextService_->removeString(kNoGamesKey);
@@ -49,7 +64,7 @@ Carousel::~Carousel() {
 
 bool Carousel::hasNext() const {
     auto next = currThumb_ + 1;
-    return next < thumbs_.size() && getTargetX(next) >= lastPossibleX_;
+    return next < static_cast<int32_t>(recaps_.size()) && getTargetX(next) >= lastPossibleX_;
 }
 
 bool Carousel::hasPrev() const {
@@ -61,11 +76,19 @@ void Carousel::update(double deltaTime, DisplayList* displaylist, const Input& i
     std::unique_lock<std::mutex> lock(mutex_);
     auto state = state_;
     lock.unlock();
+
+    // Pick up a refresh of the feed on screen, but not in the middle of scrolling
+    if (state == State::Ready && currFeed_ && currFeed_->getVersion() != feedVersion_ && targetThumb_ == currThumb_) {
+        patchFeed();
+    }
     
     switch (state) {
         case State::Ready:
         case State::Loading: {
-            if (thumbs_.size()) {
+            updateSlots();
+            updateThumbnailText();
+            updateThumbnailFocus(deltaTime);
+            if (recaps_.size()) {
                 bool movingLeft = targetThumb_ > currThumb_;
                 bool movingRight = currThumb_ > targetThumb_;
                 bool moving = movingLeft || movingRight;
@@ -101,9 +124,11 @@ void Carousel::update(double deltaTime, DisplayList* displaylist, const Input& i
                         }
                     }
                 }
-                int32_t x = x_ + SCREEN_WIDTH / 2;
-                for (int32_t i=0;i<thumbs_.size();++i) {
-                    auto& thumb = thumbs_[i];
+                // Every step before the current and target thumbnails is a downscaled one, and the slots start before both
+                int32_t x = x_ + SCREEN_WIDTH / 2 + firstThumb_ * minNeighborDistance_;
+                for (int32_t slot=0;slot<static_cast<int32_t>(thumbs_.size());++slot) {
+                    auto i = firstThumb_ + slot;
+                    auto& thumb = thumbs_[slot];
                     double scale = config_.scaleDownPercentage;
                     double step = 0;
                     if (movingLeft) {
@@ -165,6 +190,12 @@ void Carousel::update(double deltaTime, DisplayList* displaylist, const Input& i
                     thumb.y = y_;
                     thumb.scale = scale;
 
+                    if (thumb.x + w / 2 < 0 || thumb.x - w / 2 > SCREEN_WIDTH) {
+                        // In the margin, only there so its thumbnail is ready
+                        x += step;
+                        continue;
+                    }
+
                     displaylist->addRect(thumb.x, thumb.y, w, h, config_.backingColor);
                     
                     if (!moving && i == currThumb_) {
@@ -180,27 +211,42 @@ void Carousel::update(double deltaTime, DisplayList* displaylist, const Input& i
                     
                     if ((!moving && i == currThumb_) || (moving && i == targetThumb_)) {
                         // Add our header and description
-                        auto y = thumb.y - h / 2 - (thumb.headline->getHeight() * scale) / 2;
-                        displaylist->addScaledTexture(thumb.headline, thumb.x, y, scale, scale, colorOp, grayed);
-                        y = thumb.y + h / 2 + (thumb.description->getHeight() * scale) / 2;
-                        displaylist->addScaledTexture(thumb.description, thumb.x, y, scale, scale, colorOp, grayed);
+                        if (thumb.headline) {
+                            auto y = thumb.y - h / 2 - (thumb.headline->getHeight() * scale) / 2;
+                            displaylist->addScaledTexture(thumb.headline, thumb.x, y, scale, scale, colorOp, grayed);
+                        }
+                        if (thumb.description) {
+                            auto y = thumb.y + h / 2 + (thumb.description->getHeight() * scale) / 2;
+                            displaylist->addScaledTexture(thumb.description, thumb.x, y, scale, scale, colorOp, grayed);
+                        }
                     }
                     
                     if ((movingLeft && i == (targetThumb_ - 1)) || (movingRight && i == (targetThumb_ + 1))) {
                         // Add our header and description
-                        auto y = thumb.y - h / 2 - (thumb.headline->getHeight() * scale) / 2;
-                        displaylist->addScaledTexture(thumb.headline, thumb.x, y, scale, scale, colorOp, grayed);
-                        y = thumb.y + h / 2 + (thumb.description->getHeight() * scale) / 2;
-                        displaylist->addScaledTexture(thumb.description, thumb.x, y, scale, scale, colorOp, grayed);
+                        if (thumb.headline) {
+                            auto y = thumb.y - h / 2 - (thumb.headline->getHeight() * scale) / 2;
+                            displaylist->addScaledTexture(thumb.headline, thumb.x, y, scale, scale, colorOp, grayed);
+                        }
+                        if (thumb.description) {
+                            auto y = thumb.y + h / 2 + (thumb.description->getHeight() * scale) / 2;
+                            displaylist->addScaledTexture(thumb.description, thumb.x, y, scale, scale, colorOp, grayed);
+                        }
                     }
                     
                     // Fix texture if needed
                     if (!thumb.thumb && thumb.recap->getThumbnailState() == FeedGameRecap::ThumbnailState::Loaded) {
-                        thumb.thumb = textureService_->getTexture(FeedService::getThumbnailKeyForRecap(thumb.recap->date, thumb.recap->park));
+                        thumb.thumb = textureService_->getTexture(thumb.recap->getThumbnail());
+                    }
+                    if (thumb.hasFocus && !thumb.focusThumb && thumb.recap->getFocusThumbnail()) {
+                        thumb.focusThumb = textureService_->getTexture(thumb.recap->getFocusThumbnail());
                     }
                     
-                    if (thumb.thumb) {
-                        displaylist->addScaledTexture(thumb.thumb, thumb.x, thumb.y, scale, scale, colorOp, grayed);
+                    auto& tex = thumb.focusThumb ? thumb.focusThumb : thumb.thumb;
+                    if (tex) {
+                        // Cuts come in different sizes, they're all drawn at the slot's size
+                        auto scaleX = scale * config_.thumbnailWidth / tex->getWidth();
+                        auto scaleY = scale * config_.thumbnailHeight / tex->getHeight();
+                        displaylist->addScaledTexture(tex, thumb.x, thumb.y, scaleX, scaleY, colorOp, grayed);
                     } else {
                         // We are either error or loading
                         if (thumb.recap->getThumbnailState() == FeedGameRecap::ThumbnailState::Loading) {
@@ -231,6 +277,7 @@ void Carousel::update(double deltaTime, DisplayList* displaylist, const Input& i
 
 void Carousel::setFeed(const std::shared_ptr<Feed>& feed) {
     std::lock_guard<std::mutex> lock(mutex_);
+    releaseThumbnails();
     state_ = State::Ready;
     currFeed_ = feed;
     state_ = State::Ready;
@@ -240,21 +287,191 @@ void Carousel::setFeed(const std::shared_ptr<Feed>& feed) {
     targetThumb_ = 0;
     targetX_ = 0;
 
-    auto numRecaps = feed->getNumRecaps();
+    // Version first, so a patch made while we're reading is picked up next update
+    feedVersion_ = feed->getVersion();
+    recaps_ = feed->getRecaps();
+    // Slots are created by the next update
+    firstThumb_ = 0;
+    updateLastPossibleX();
+}
+
+void Carousel::patchFeed() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    feedVersion_ = currFeed_->getVersion();
+
+    bool hasCurr = currThumb_ < static_cast<int32_t>(recaps_.size());
+    uint32_t currPark = hasCurr ? recaps_[currThumb_]->park : 0;
+    recaps_ = currFeed_->getRecaps();
+
+    // Stay on the same game if it is still there, otherwise stay as close to where we were as we can
+    int32_t curr = std::min(currThumb_, static_cast<int32_t>(recaps_.size()) - 1);
+    for (int32_t i=0;hasCurr && i<static_cast<int32_t>(recaps_.size());++i) {
+        if (recaps_[i]->park == currPark) {
+            curr = i;
+            break;
+        }
+    }
+    currThumb_ = std::max(curr, 0);
+    targetThumb_ = currThumb_;
+    targetX_ = getTargetX(currThumb_);
+    x_ = targetX_;
+    updateLastPossibleX();
+
+    // Unchanged games keep the same recap, and with it the slot we've already set up
+    std::unordered_map<FeedGameRecap *, size_t> previous;
+    for (size_t i=0;i<thumbs_.size();++i) {
+        previous[thumbs_[i].recap.get()] = i;
+    }
+    std::vector<bool> kept(thumbs_.size(), false);
+
+    int32_t first, last;
+    getSlotRange(first, last);
+    std::deque<Thumbnail> thumbs;
+    for (auto i=first;i<last;++i) {
+        auto it = previous.find(recaps_[i].get());
+        if (it != previous.end()) {
+            thumbs.push_back(thumbs_[it->second]);
+            kept[it->second] = true;
+        } else {
+            thumbs.emplace_back(createThumbnail(recaps_[i], getThumbnailPriority(i)));
+        }
+    }
+    // Those of recaps which were replaced have already been released by FeedService, this is for the ones which
+    // have moved out of the window
+    for (size_t i=0;i<thumbs_.size();++i) {
+        if (!kept[i]) {
+            releaseThumbnail(thumbs_[i]);
+        }
+    }
+    thumbs_ = std::move(thumbs);
+    firstThumb_ = first;
+}
+
+Thumbnail Carousel::createThumbnail(const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority) {
+    Thumbnail thumb(recap, config_.thumbnailWidth + 2 * config_.frameOffsetX, config_.thumbnailHeight + 2 * config_.frameOffsetY);
+    // Text is filled in by updateThumbnailText once we get close to it
+    feedService_->acquireThumbnail(currFeed_, recap, priority);
+    updateThumbnailThumb(thumb);
+    // A refresh carries the focused cut over to the new recap, it's ours to release
+    thumb.hasFocus = static_cast<bool>(recap->getFocusThumbnail());
+    return thumb;
+}
+
+void Carousel::releaseThumbnail(Thumbnail& thumb) {
+    if (thumb.hasText) {
+        feedService_->releaseRecapText(currFeed_, thumb.recap);
+    }
+    if (thumb.hasFocus) {
+        feedService_->releaseFocusThumbnail(currFeed_, thumb.recap);
+    }
+    feedService_->releaseThumbnail(currFeed_, thumb.recap);
+}
+
+void Carousel::releaseThumbnails() {
+    if (currFeed_) {
+        for (auto& thumb : thumbs_) {
+            releaseThumbnail(thumb);
+        }
+    }
     thumbs_.clear();
-    for (decltype(numRecaps) i=0;i<numRecaps;++i) {
-        auto recap = feed->getRecapAtIndex(i);
-        Thumbnail thumb(recap, config_.thumbnailWidth + 2 * config_.frameOffsetX, config_.thumbnailHeight + 2 * config_.frameOffsetY);
-        // Get the needed textures
-        auto key = FeedService::getHeadlineKeyForRecap(feed->getDate(), recap->park);
-        thumb.headline = fontTextService_->getString(key);
-        key = FeedService::getDescriptionKeyForRecap(feed->getDate(), recap->park);
-        thumb.description = fontTextService_->getString(key);
-        updateThumbnailThumb(thumb);
-        thumbs_.emplace_back(thumb);
+    firstThumb_ = 0;
+}
+
+void Carousel::getSlotRange(int32_t& first, int32_t& last) const {
+    first = std::max(std::min(currThumb_, targetThumb_) - slotRadius_, 0);
+    last = std::min(std::max(currThumb_, targetThumb_) + slotRadius_ + 1, static_cast<int32_t>(recaps_.size()));
+}
+
+FetchPriority Carousel::getThumbnailPriority(int32_t index) const {
+    // Those on screen go ahead of the margin
+    return abs(index - targetThumb_) <= slotRadius_ - kSlotMargin ? FetchPriority::High : FetchPriority::Normal;
+}
+
+void Carousel::updateSlots() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!currFeed_) {
+        return;
+    }
+    int32_t first, last;
+    getSlotRange(first, last);
+    if (thumbs_.empty() || last <= firstThumb_ || first >= firstThumb_ + static_cast<int32_t>(thumbs_.size())) {
+        // Nothing in common, such as after setFeed
+        releaseThumbnails();
+        firstThumb_ = first;
+    }
+    while (firstThumb_ < first && thumbs_.size()) {
+        releaseThumbnail(thumbs_.front());
+        thumbs_.pop_front();
+        ++firstThumb_;
+    }
+    while (firstThumb_ + static_cast<int32_t>(thumbs_.size()) > last) {
+        releaseThumbnail(thumbs_.back());
+        thumbs_.pop_back();
+    }
+    while (firstThumb_ > first) {
+        --firstThumb_;
+        thumbs_.emplace_front(createThumbnail(recaps_[firstThumb_], getThumbnailPriority(firstThumb_)));
+    }
+    while (firstThumb_ + static_cast<int32_t>(thumbs_.size()) < last) {
+        auto index = firstThumb_ + static_cast<int32_t>(thumbs_.size());
+        thumbs_.emplace_back(createThumbnail(recaps_[index], getThumbnailPriority(index)));
     }
-    if (thumbs_.size()) {
-        lastPossibleX_ = getTargetX(static_cast<int32_t>(thumbs_.size() - 1));
+}
+
+void Carousel::updateThumbnailText() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!currFeed_) {
+        return;
+    }
+    // Focus on where we're heading so its text is there by the time we arrive
+    for (int32_t slot=0;slot<static_cast<int32_t>(thumbs_.size());++slot) {
+        auto i = firstThumb_ + slot;
+        auto& thumb = thumbs_[slot];
+        auto distance = abs(i - targetThumb_);
+        if (distance <= kTextRadius && !thumb.hasText) {
+            auto text = feedService_->acquireRecapText(currFeed_, thumb.recap);
+            thumb.headline = text.headline;
+            thumb.description = text.description;
+            thumb.hasText = true;
+        } else if (distance > kTextReleaseRadius && thumb.hasText) {
+            feedService_->releaseRecapText(currFeed_, thumb.recap);
+            thumb.headline = nullptr;
+            thumb.description = nullptr;
+            thumb.hasText = false;
+        }
+    }
+}
+
+void Carousel::updateThumbnailFocus(double deltaTime) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!currFeed_) {
+        return;
+    }
+    for (int32_t slot=0;slot<static_cast<int32_t>(thumbs_.size());++slot) {
+        auto i = firstThumb_ + slot;
+        auto& thumb = thumbs_[slot];
+        auto distance = abs(i - targetThumb_);
+        if (distance == 0 && !thumb.hasFocus) {
+            feedService_->focusThumbnail(currFeed_, thumb.recap);
+            thumb.hasFocus = true;
+            focusRetry_ = kFocusRetryInterval;
+        } else if (distance == 0 && !thumb.focusThumb) {
+            focusRetry_ -= deltaTime;
+            if (focusRetry_ <= 0) {
+                feedService_->focusThumbnail(currFeed_, thumb.recap);
+                focusRetry_ = kFocusRetryInterval;
+            }
+        } else if (distance > kFocusReleaseRadius && thumb.hasFocus) {
+            feedService_->releaseFocusThumbnail(currFeed_, thumb.recap);
+            thumb.focusThumb = nullptr;
+            thumb.hasFocus = false;
+        }
+    }
+}
+
+void Carousel::updateLastPossibleX() {
+    if (recaps_.size()) {
+        lastPossibleX_ = getTargetX(static_cast<int32_t>(recaps_.size() - 1));
     } else {
         lastPossibleX_ = 0;
     }
@@ -268,8 +485,7 @@ void Carousel::loadingNextFeed() {
 
 void Carousel::updateThumbnailThumb(Thumbnail& thumb) {
     if (thumb.recap->getThumbnailState() == FeedGameRecap::ThumbnailState::Loaded) {
-        auto key = FeedService::getThumbnailKeyForRecap(thumb.recap->date, thumb.recap->park);
-        thumb.thumb = textureService_->getTexture(key);
+        thumb.thumb = textureService_->getTexture(thumb.recap->getThumbnail());
     }
 }
 
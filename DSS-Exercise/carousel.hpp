@@ -19,6 +19,9 @@
 #include "fontTextService.hpp"
 #include "displayList.hpp"
 
+class FeedService;
+
+#include <deque>
 #include <vector>
 #include <mutex>
 
@@ -37,7 +40,7 @@ struct CarouselConfig {
 
 class Carousel {
 public:
-    Carousel(CarouselConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, bool verbose);
+    Carousel(CarouselConfig config, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, bool verbose);
     ~Carousel();
 
     void setFeed(const std::shared_ptr<Feed>& feed);
@@ -64,18 +67,26 @@ private:
     int                                 targetX_;
     int                                 lastPossibleX_;
     double                              loadingRotate_;
+    double                              focusRetry_;    // Seconds until the focused cut is asked for again
     int                                 minNeighborDistance_;
     int                                 maxNeighborDistance_;
+    int32_t                             slotRadius_;    // Slots either side of the current thumbnail, covers the screen plus a margin
 
     int                                 backingW_;
     int                                 backingH_;
 
-    std::vector<Thumbnail>              thumbs_;
+    // Only the games around the current one have a slot, so the cost of a frame doesn't depend on the feed's length.
+    // thumbs_[i] is recaps_[firstThumb_ + i]
+    std::vector<std::shared_ptr<FeedGameRecap>> recaps_;
+    std::deque<Thumbnail>               thumbs_;
+    int32_t                             firstThumb_;
     
     std::shared_ptr<Feed>               currFeed_;
+    uint32_t                            feedVersion_;   // Version of currFeed_ thumbs_ was built from
     
     std::shared_ptr<TextureService>     textureService_;
     std::shared_ptr<FontTextService>    fontTextService_;
+    std::shared_ptr<FeedService>        feedService_;
     
     std::shared_ptr<Texture>            loadingIconTex_;
     std::shared_ptr<Texture>            linkErrorTex_;
@@ -85,6 +96,23 @@ private:
     std::mutex                          mutex_;
     
     void updateThumbnailThumb(Thumbnail& thumb);
+    // Acquires the recap's thumbnail, which is held for as long as the slot is
+    Thumbnail createThumbnail(const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority);
+    // Hands back the thumbnail, text and focused cut of a slot leaving the window
+    void releaseThumbnail(Thumbnail& thumb);
+    void releaseThumbnails();
+    // Slots are created for the games coming within slotRadius_ of the current and target ones, and released as they
+    // leave, so scrolling only touches the slots at either end
+    void getSlotRange(int32_t& first, int32_t& last) const;
+    FetchPriority getThumbnailPriority(int32_t index) const;
+    void updateSlots();
+    // Rebuilds recaps_ and the slots after FeedService has patched currFeed_, keeping the current game selected
+    void patchFeed();
+    void updateLastPossibleX();
+    // Acquires text for the thumbnails around the one we're on or heading to, and releases it far away from it
+    void updateThumbnailText();
+    // Upgrades the thumbnail we're heading to to its focused cut, and drops the upgrade once we've moved on
+    void updateThumbnailFocus(double deltaTime);
     
     void gotoNextThumb();
     void gotoPrevThumb();
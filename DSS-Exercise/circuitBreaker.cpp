@@ -0,0 +1,76 @@
+//
+//  circuitBreaker.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/7/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "circuitBreaker.hpp"
+#include "epoch.h"
+
+CircuitBreaker::CircuitBreaker(uint32_t failureThreshold, int64_t openDuration, uint32_t maxProbes) : state_(State::Closed), failureThreshold_(failureThreshold), consecutiveFailures_(0), openDuration_(openDuration), openedAt_(0), maxProbes_(maxProbes), probesInFlight_(0) {
+}
+
+bool CircuitBreaker::allowRequest() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (state_) {
+        case State::Closed:
+            return true;
+        case State::Open:
+            if ((EpochTime::timeInMilliSec() - openedAt_) < openDuration_) {
+                return false;
+            }
+            // Cool down has elapsed, start letting probes through
+            state_ = State::HalfOpen;
+            probesInFlight_ = 0;
+            // Fall through
+        case State::HalfOpen:
+            if (probesInFlight_ < maxProbes_) {
+                ++probesInFlight_;
+                return true;
+            }
+            return false;
+    }
+    return true;
+}
+
+void CircuitBreaker::recordSuccess() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    consecutiveFailures_ = 0;
+    probesInFlight_ = 0;
+    state_ = State::Closed;
+}
+
+void CircuitBreaker::recordFailure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (state_) {
+        case State::Closed:
+            if (++consecutiveFailures_ >= failureThreshold_) {
+                open();
+            }
+            break;
+        case State::HalfOpen:
+            // Probe failed, back to open
+            open();
+            break;
+        case State::Open:
+            // Failures from requests that were in flight when we opened. Nothing to do
+            break;
+    }
+}
+
+CircuitBreaker::State CircuitBreaker::getState() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return state_;
+}
+
+bool CircuitBreaker::isOpen() {
+    return getState() == State::Open;
+}
+
+void CircuitBreaker::open() {
+    state_ = State::Open;
+    openedAt_ = EpochTime::timeInMilliSec();
+    probesInFlight_ = 0;
+}
@@ -0,0 +1,49 @@
+//
+//  circuitBreaker.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/7/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef circuitBreaker_hpp
+#define circuitBreaker_hpp
+
+#include <stdio.h>
+#include <cstdint>
+#include <mutex>
+
+// Simple per-host circuit breaker.
+// Closed: requests flow normally. Consecutive failures are counted and once we hit the threshold we open.
+// Open: requests fail fast until the open duration has elapsed.
+// HalfOpen: a limited number of probe requests are let through. A success closes the breaker, a failure re-opens it.
+class CircuitBreaker {
+public:
+    enum class State { Closed, Open, HalfOpen };
+
+    CircuitBreaker() = delete;
+    CircuitBreaker(uint32_t failureThreshold, int64_t openDuration, uint32_t maxProbes);    // openDuration is in milliseconds
+
+    // Returns false if the request should fail fast
+    bool allowRequest();
+    void recordSuccess();
+    void recordFailure();
+
+    State getState();
+    bool isOpen();
+
+private:
+    std::mutex  mutex_;
+    State       state_;
+
+    uint32_t    failureThreshold_;
+    uint32_t    consecutiveFailures_;
+    int64_t     openDuration_;
+    int64_t     openedAt_;
+    uint32_t    maxProbes_;
+    uint32_t    probesInFlight_;
+
+    void open();
+};
+
+#endif /* circuitBreaker_hpp */
@@ -0,0 +1,143 @@
+//
+//  compactFeed.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/19/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "compactFeed.hpp"
+
+#include <new>
+#include <unordered_map>
+
+// Heap bytes behind a std::string. Short strings live inside the std::string itself
+static size_t getStringHeapBytes(const std::string& str, size_t& allocations) {
+    auto data = str.data();
+    auto object = reinterpret_cast<const char *>(&str);
+    if (data >= object && data < object + sizeof(std::string)) {
+        return 0;
+    }
+    allocations++;
+    return str.capacity() + 1;
+}
+
+CompactFeed::CompactFeed(const std::shared_ptr<Feed>& feed) : stringBytes_(0) {
+    auto recaps = feed->getRecaps();
+    auto date = feed->getDate();
+    numRecaps_ = recaps.size();
+
+    // Keys point into recaps and date, which outlive the table
+    std::unordered_map<std::string_view, StringRef> table;
+    std::string strings;
+    auto intern = [this, &table, &strings](const std::string& str) {
+        stringBytes_ += str.size();
+        auto it = table.find(str);
+        if (it != table.end()) {
+            return it->second;
+        }
+        StringRef ref{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(str.size()) };
+        strings.append(str);
+        table.emplace(std::string_view(str), ref);
+        return ref;
+    };
+
+    date_ = intern(date);
+    std::vector<Recap> flat;
+    std::vector<Cut> flatCuts;
+    flat.reserve(numRecaps_);
+    for (auto& recap : recaps) {
+        auto firstCut = static_cast<uint32_t>(flatCuts.size());
+        for (auto& cut : recap->thumbnailCuts) {
+            flatCuts.push_back(Cut{ cut.width, cut.height, intern(cut.url) });
+        }
+        flat.push_back(Recap{ recap->park, intern(recap->headline), intern(recap->description), intern(recap->thumbnailUrl), firstCut, static_cast<uint32_t>(recap->thumbnailCuts.size()) });
+    }
+    numCuts_ = flatCuts.size();
+
+    static_assert(alignof(Cut) <= alignof(Recap), "Cuts follow the recaps without padding");
+    static_assert(alignof(std::atomic<ThumbnailState>) <= alignof(Cut), "States follow the cuts without padding");
+    auto recapBytes = numRecaps_ * sizeof(Recap);
+    auto cutBytes = numCuts_ * sizeof(Cut);
+    auto stateBytes = numRecaps_ * sizeof(std::atomic<ThumbnailState>);
+    arenaSize_ = recapBytes + cutBytes + stateBytes + strings.size();
+    // new[] is aligned for any fundamental type, which covers Recap
+    arena_.reset(new uint8_t[arenaSize_ ? arenaSize_ : 1]);
+
+    recaps_ = reinterpret_cast<Recap *>(arena_.get());
+    std::uninitialized_copy(flat.begin(), flat.end(), recaps_);
+    cuts_ = reinterpret_cast<Cut *>(arena_.get() + recapBytes);
+    std::uninitialized_copy(flatCuts.begin(), flatCuts.end(), cuts_);
+    states_ = reinterpret_cast<std::atomic<ThumbnailState> *>(arena_.get() + recapBytes + cutBytes);
+    for (size_t i=0;i<numRecaps_;++i) {
+        new (&states_[i]) std::atomic<ThumbnailState>(ThumbnailState::Unloaded);
+    }
+    auto stringTable = reinterpret_cast<char *>(arena_.get() + recapBytes + cutBytes + stateBytes);
+    std::copy(strings.begin(), strings.end(), stringTable);
+    strings_ = stringTable;
+}
+
+std::string_view CompactFeed::getThumbnailUrl(size_t index, uint32_t width, uint32_t height) const {
+    auto& recap = recaps_[index];
+    if (!width || !recap.numCuts) {
+        return getString(recap.thumbnailUrl);
+    }
+    for (uint32_t i=0;i<recap.numCuts;++i) {
+        auto& cut = cuts_[recap.firstCut + i];
+        if (cut.width >= width && cut.height >= height) {
+            return getString(cut.url);
+        }
+    }
+    return getString(cuts_[recap.firstCut + recap.numCuts - 1].url);
+}
+
+std::shared_ptr<FeedGameRecap> CompactFeed::getRecap(size_t index) const {
+    auto& recap = recaps_[index];
+    std::vector<ThumbnailCut> cuts;
+    cuts.reserve(recap.numCuts);
+    for (uint32_t i=0;i<recap.numCuts;++i) {
+        auto& cut = cuts_[recap.firstCut + i];
+        cuts.push_back(ThumbnailCut{ cut.width, cut.height, std::string(getString(cut.url)) });
+    }
+    return std::make_shared<FeedGameRecap>(std::string(getDate()), getPark(index), std::string(getHeadline(index)), std::string(getDescription(index)), std::string(getThumbnailUrl(index)), std::move(cuts));
+}
+
+size_t CompactFeed::getFeedBytes(const std::shared_ptr<Feed>& feed, size_t *allocations) {
+    size_t numAllocations = 0;
+    auto recaps = feed->getRecaps();
+    // The feed itself and its recap vector
+    size_t bytes = sizeof(Feed) + recaps.size() * sizeof(std::shared_ptr<FeedGameRecap>);
+    numAllocations += recaps.size() ? 2 : 1;
+    for (auto& recap : recaps) {
+        // make_shared puts the recap and its two reference counts in one block
+        bytes += sizeof(FeedGameRecap) + 2 * sizeof(long);
+        numAllocations++;
+        for (auto str : { &recap->date, &recap->headline, &recap->description, &recap->thumbnailUrl }) {
+            bytes += getStringHeapBytes(*str, numAllocations);
+        }
+        if (recap->thumbnailCuts.size()) {
+            bytes += recap->thumbnailCuts.capacity() * sizeof(ThumbnailCut);
+            numAllocations++;
+        }
+        for (auto& cut : recap->thumbnailCuts) {
+            bytes += getStringHeapBytes(cut.url, numAllocations);
+        }
+    }
+    if (allocations) {
+        *allocations = numAllocations;
+    }
+    return bytes;
+}
+
+CompactFeed::MemoryReport CompactFeed::getMemoryReport(const std::shared_ptr<Feed>& feed) {
+    MemoryReport report{};
+    CompactFeed compact(feed);
+    report.recaps = compact.getNumRecaps();
+    report.feedBytes = getFeedBytes(feed, &report.feedAllocations);
+    report.compactBytes = compact.getBytes();
+    // The CompactFeed and its arena
+    report.compactAllocations = 2;
+    report.stringBytes = compact.stringBytes_;
+    report.uniqueStringBytes = compact.arenaSize_ - report.recaps * (sizeof(Recap) + sizeof(std::atomic<ThumbnailState>)) - compact.numCuts_ * sizeof(Cut);
+    return report;
+}
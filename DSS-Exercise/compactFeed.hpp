@@ -0,0 +1,102 @@
+//
+//  compactFeed.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/19/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef compactFeed_hpp
+#define compactFeed_hpp
+
+#include <stdio.h>
+#include "feed.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Read only form of a Feed in a single allocation. The arena holds the recaps by value, a side array of their
+// thumbnail states and a string table. Strings are stored once per feed however many recaps share them
+// (the date always, often the description when it falls back to the headline), and recaps refer to them by offset.
+//
+// Arena layout: Recap[numRecaps], Cut[numCuts], std::atomic<ThumbnailState>[numRecaps], string bytes
+class CompactFeed {
+public:
+    using ThumbnailState = FeedGameRecap::ThumbnailState;
+
+    // Sizes of the two representations of the same feed, see getMemoryReport
+    struct MemoryReport {
+        size_t      recaps;
+        size_t      feedBytes;          // Feed with shared_ptr<FeedGameRecap>s, including the heap blocks behind them
+        size_t      feedAllocations;
+        size_t      compactBytes;
+        size_t      compactAllocations;
+        size_t      stringBytes;        // Total length of the recaps' strings
+        size_t      uniqueStringBytes;  // What's left in the string table after deduplication
+    };
+
+    CompactFeed() = delete;
+    CompactFeed(const std::shared_ptr<Feed>& feed);
+
+    CompactFeed(const CompactFeed&) = delete;
+    CompactFeed& operator=(const CompactFeed&) = delete;
+
+    std::string_view getDate() const { return getString(date_); }
+    size_t getNumRecaps() const { return numRecaps_; }
+    // Views are valid for the life of the CompactFeed
+    uint32_t getPark(size_t index) const { return recaps_[index].park; }
+    std::string_view getHeadline(size_t index) const { return getString(recaps_[index].headline); }
+    std::string_view getDescription(size_t index) const { return getString(recaps_[index].description); }
+    std::string_view getThumbnailUrl(size_t index) const { return getString(recaps_[index].thumbnailUrl); }
+    // Same choice as FeedGameRecap::getThumbnailUrl
+    std::string_view getThumbnailUrl(size_t index, uint32_t width, uint32_t height) const;
+    ThumbnailState getThumbnailState(size_t index) const { return states_[index]; }
+    void setThumbnailState(size_t index, ThumbnailState state) { states_[index] = state; }
+
+    // Back to the shared representation, eg. for the carousel
+    std::shared_ptr<FeedGameRecap> getRecap(size_t index) const;
+
+    // Everything behind the CompactFeed, the object included
+    size_t getBytes() const { return sizeof(CompactFeed) + arenaSize_; }
+    // Estimate, std::string and shared_ptr internals are up to the standard library
+    static size_t getFeedBytes(const std::shared_ptr<Feed>& feed, size_t *allocations = nullptr);
+    static MemoryReport getMemoryReport(const std::shared_ptr<Feed>& feed);
+
+private:
+    struct StringRef {
+        uint32_t    offset;
+        uint32_t    length;
+    };
+
+    struct Recap {
+        uint32_t    park;
+        StringRef   headline;
+        StringRef   description;
+        StringRef   thumbnailUrl;
+        uint32_t    firstCut;
+        uint32_t    numCuts;
+    };
+
+    struct Cut {
+        uint32_t    width;
+        uint32_t    height;
+        StringRef   url;
+    };
+
+    size_t                      numRecaps_;
+    size_t                      numCuts_;
+    size_t                      arenaSize_;
+    size_t                      stringBytes_;       // Before deduplication
+    std::unique_ptr<uint8_t[]>  arena_;
+    Recap                       *recaps_;           // Into arena_
+    Cut                         *cuts_;             // Into arena_
+    std::atomic<ThumbnailState> *states_;           // Into arena_
+    const char                  *strings_;          // Into arena_
+    StringRef                   date_;
+
+    std::string_view getString(StringRef ref) const { return std::string_view(strings_ + ref.offset, ref.length); }
+};
+
+#endif /* compactFeed_hpp */
@@ -0,0 +1,126 @@
+//
+//  dateIndex.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/17/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "dateIndex.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+// Howard Hinnant's days_from_civil and civil_from_days. Eras are 400 year cycles of 146097 days, and the year is
+// shifted to start in March so the leap day falls at the end
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    const int32_t era = (y >= 0 ? y : y - 399) / 400;
+    const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+    const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
+
+static void civilFromDays(int32_t z, int32_t& y, uint32_t& m, uint32_t& d) {
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const uint32_t doe = static_cast<uint32_t>(z - era * 146097);
+    const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const uint32_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int32_t>(yoe) + era * 400 + (m <= 2);
+}
+
+DateIndex::DateIndex(const std::string& firstDate, const std::string& lastDate) {
+    int32_t lastDay = 0;
+    if (!parseDate(firstDate, firstDay_) || !parseDate(lastDate, lastDay)) {
+        throw std::invalid_argument("Dates must be YYYY-MM-DD");
+    }
+    if (lastDay < firstDay_) {
+        throw std::invalid_argument("Last date " + lastDate + " is before first date " + firstDate);
+    }
+    numDays_ = lastDay - firstDay_ + 1;
+}
+
+std::string DateIndex::getDate(size_t index) const {
+    if (index < size()) {
+        return formatDate(firstDay_ + static_cast<int32_t>(index));
+    }
+    return std::string();
+}
+
+int64_t DateIndex::findDate(const std::string& date) const {
+    int32_t day = 0;
+    if (!parseDate(date, day) || day < firstDay_ || day - firstDay_ >= numDays_) {
+        return -1;
+    }
+    return day - firstDay_;
+}
+
+DateIndex::DateInfo DateIndex::getInfo(size_t index) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(static_cast<uint32_t>(index));
+    if (it == entries_.end()) {
+        return DateInfo{-1, false};
+    }
+    return DateInfo{it->second.hasNumGames ? it->second.numGames : -1, it->second.cached != 0};
+}
+
+void DateIndex::setNumGames(const std::string& date, uint32_t numGames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = getEntry(date);
+    if (entry) {
+        entry->numGames = static_cast<uint16_t>(std::min<uint32_t>(numGames, std::numeric_limits<uint16_t>::max()));
+        entry->hasNumGames = 1;
+    }
+}
+
+void DateIndex::setCached(const std::string& date, bool cached) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry = getEntry(date);
+    if (entry) {
+        entry->cached = cached;
+    }
+}
+
+DateIndex::Entry *DateIndex::getEntry(const std::string& date) {
+    auto index = findDate(date);
+    if (index < 0) {
+        return nullptr;
+    }
+    auto it = entries_.find(static_cast<uint32_t>(index));
+    if (it == entries_.end()) {
+        it = entries_.emplace(static_cast<uint32_t>(index), Entry{0, 0, 0}).first;
+    }
+    return &it->second;
+}
+
+bool DateIndex::parseDate(const std::string& date, int32_t& day) {
+    int y = 0;
+    unsigned m = 0;
+    unsigned d = 0;
+    int consumed = 0;
+    if (date.size() != 10 || sscanf(date.c_str(), "%4d-%2u-%2u%n", &y, &m, &d, &consumed) != 3 || consumed != 10) {
+        return false;
+    }
+    if (m < 1 || m > 12 || d < 1 || d > 31) {
+        return false;
+    }
+    // Anything the calendar doesn't have, eg. 2022-02-30, comes back as a different date
+    day = daysFromCivil(y, m, d);
+    return formatDate(day) == date;
+}
+
+std::string DateIndex::formatDate(int32_t day) {
+    int32_t y = 0;
+    uint32_t m = 0;
+    uint32_t d = 0;
+    civilFromDays(day, y, m, d);
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", y, m, d);
+    return std::string(buffer);
+}
@@ -0,0 +1,63 @@
+//
+//  dateIndex.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/17/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef dateIndex_hpp
+#define dateIndex_hpp
+
+#include <stdio.h>
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+// A contiguous range of calendar dates, eg. a season or several. Dates are held as a first day number and a
+// count, so the range costs the same whether it is a week or a decade. Date strings are built when asked for, and
+// metadata is only kept for the dates we've learned something about. Thread safe
+class DateIndex {
+public:
+    struct DateInfo {
+        int32_t     numGames;   // -1 until a feed for the date has been seen
+        bool        cached;     // The feed is in memory right now
+    };
+
+    DateIndex() = delete;
+    // Dates are YYYY-MM-DD, inclusive. Throws std::invalid_argument if either is malformed or last is before first
+    DateIndex(const std::string& firstDate, const std::string& lastDate);
+
+    size_t size() const { return static_cast<size_t>(numDays_); }
+    // Empty if index is out of range
+    std::string getDate(size_t index) const;
+    // -1 if the date is malformed or outside the range
+    int64_t findDate(const std::string& date) const;
+
+    DateInfo getInfo(size_t index) const;
+    void setNumGames(const std::string& date, uint32_t numGames);
+    void setCached(const std::string& date, bool cached);
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar
+    static bool parseDate(const std::string& date, int32_t& day);
+    static std::string formatDate(int32_t day);
+
+private:
+    // Packed into 4 bytes, there may be one for every date visited in a long session
+    struct Entry {
+        uint16_t    numGames;
+        uint8_t     hasNumGames : 1;
+        uint8_t     cached : 1;
+    };
+
+    int32_t                                 firstDay_;
+    int32_t                                 numDays_;
+
+    mutable std::mutex                      mutex_;
+    std::unordered_map<uint32_t, Entry>     entries_;   // By index
+
+    Entry *getEntry(const std::string& date);
+};
+
+#endif /* dateIndex_hpp */
@@ -8,24 +8,37 @@
 
 #include "dateSelector.hpp"
 
-DateSelector::DateSelector(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTexService, const std::shared_ptr<FeedService>& feedService, const std::shared_ptr<Carousel>& carousel, int x, int y, bool verbose) : verbose_(verbose), carousel_(carousel), textureService_(texService), fontTexService_(fontTexService), feedService_(feedService), state_(State::Ready), x_(x), y_(y) {
+// Between the date and its game count
+static const int kGamesLabelSpacing = 16;
+// Seconds between looking for a stale feed and a changed game count. Both take locks, and feeds go stale over minutes
+static const double kCheckInterval = 1;
+
+DateSelector::DateSelector(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTexService, const std::shared_ptr<FeedService>& feedService, const std::shared_ptr<Carousel>& carousel, int x, int y, bool verbose) : verbose_(verbose), carousel_(carousel), textureService_(texService), fontTexService_(fontTexService), feedService_(feedService), state_(State::Ready), x_(x), y_(y), labelIndex_(-1), labelNumGames_(-1), labelStale_(false), checkTimer_(kCheckInterval) {
     currDateIndex_ = feedService->getDefaultDateIndex();
-    auto num = feedService->getNumDates();
-    for (decltype(num) i=0;i<num;++i) {
-        auto date = feedService->getDateAtIndex(i);
-        auto tex = fontTexService->addString(FontTextService::Font::Roboto48, date, date, { 0xFF, 0xFF, 0xFF, 0xFF });
-        if (tex) {
-            dateTex_.push_back(tex);
-        }
-    }
+    updateLabel();
+    // Have the neighbouring feeds ready before the user moves
+    feedService->prefetchAround(currDateIndex_);
+}
+
+DateSelector::~DateSelector() {
+    releaseLabel();
 }
 
 void DateSelector::update(double deltaTime, DisplayList* displaylist, const Input& input) {
     std::unique_lock<std::mutex> lock(mutex_);
     auto state = state_;
     lock.unlock();
+    bool check = false;
+    checkTimer_ -= deltaTime;
+    if (checkTimer_ <= 0) {
+        checkTimer_ = kCheckInterval;
+        check = true;
+    }
     switch (state) {
         case State::Ready:
+            if (check) {
+                feedService_->refreshIfStale(feedService_->getDateAtIndex(currDateIndex_));
+            }
             if (input.up && hasPrev()) {
                 gotoPrev();
             }
@@ -42,6 +55,8 @@ void DateSelector::update(double deltaTime, DisplayList* displaylist, const Inpu
                 carousel_->setFeed(feed);
             }
             lock.unlock();
+            // The fetch has landed, so the game count is likely in
+            check = true;
         }
         default:
             break;
@@ -54,8 +69,16 @@ void DateSelector::update(double deltaTime, DisplayList* displaylist, const Inpu
         colorOp = DisplayObject::ColorOp::Tint | DisplayObject::ColorOp::Alpha;
     }
 
-    auto tex = dateTex_[currDateIndex_];
-    displaylist->addTexture(tex, x_, y_ - tex->getHeight() / 2, colorOp, grayed);
+    // Moving dates relabels straight away, otherwise the count and staleness are picked up by the next check
+    if (check || labelIndex_ != currDateIndex_) {
+        updateLabel();
+    }
+    if (dateTex_) {
+        displaylist->addTexture(dateTex_, x_, y_ - dateTex_->getHeight() / 2, colorOp, grayed);
+        if (gamesTex_) {
+            displaylist->addTexture(gamesTex_, x_ + dateTex_->getWidth() + kGamesLabelSpacing, y_ - gamesTex_->getHeight() / 2, colorOp, grayed);
+        }
+    }
 }
 
 bool DateSelector::hasNext() {
@@ -70,13 +93,49 @@ bool DateSelector::hasPrev() {
 }
 
 int DateSelector::getHeight() const {
-    auto tex = dateTex_[currDateIndex_];
-    if (tex) {
-        return tex->getHeight();
+    if (dateTex_) {
+        return dateTex_->getHeight();
     }
     return 0;
 }
 
+void DateSelector::updateLabel() {
+    // The game count turns up once the date's feed has been fetched
+    auto numGames = feedService_->getDateIndex()->getInfo(currDateIndex_).numGames;
+    auto date = feedService_->getDateAtIndex(currDateIndex_);
+    // A saved copy is being shown while the network catches up, or because it couldn't
+    auto feed = feedService_->getFeed(date);
+    bool stale = feed && feed->isStale();
+    if (labelIndex_ == currDateIndex_ && labelNumGames_ == numGames && labelStale_ == stale) {
+        return;
+    }
+    releaseLabel();
+    dateTex_ = fontTexService_->addString(FontTextService::Font::Roboto48, date, date, { 0xFF, 0xFF, 0xFF, 0xFF });
+    if (numGames >= 0) {
+        auto games = numGames == 1 ? std::string("1 game") : std::to_string(numGames) + " games";
+        if (stale) {
+            games += " (saved)";
+        }
+        gamesTex_ = fontTexService_->addString(FontTextService::Font::Roboto20, date + "-games", games, { 0xA0, 0xA0, 0xA0, 0xFF });
+    }
+    labelIndex_ = currDateIndex_;
+    labelNumGames_ = numGames;
+    labelStale_ = stale;
+}
+
+void DateSelector::releaseLabel() {
+    if (labelIndex_ >= 0) {
+        auto date = feedService_->getDateAtIndex(labelIndex_);
+        fontTexService_->removeString(date);
+        fontTexService_->removeString(date + "-games");
+    }
+    dateTex_ = nullptr;
+    gamesTex_ = nullptr;
+    labelIndex_ = -1;
+    labelNumGames_ = -1;
+    labelStale_ = false;
+}
+
 
 void DateSelector::gotoNext() {
     // unique_lock used here because fetchFeed may actually return on the same thread, so lock_guard will deadlock
@@ -90,10 +149,13 @@ void DateSelector::gotoNext() {
         state_ = State::Fetching;
         lock.unlock();
         carousel_->loadingNextFeed();
+        // Keep the date we're moving to from being evicted by the prefetches which are about to follow
+        feedService_->pinFeed(date);
         feedService_->fetchFeed(date, [this](Error error, uint32_t status, std::shared_ptr<Feed> feed) {
             std::lock_guard<std::mutex> lock(mutex_);
             state_ = State::NotifyCarousel;
         });
+        feedService_->prefetchAround(currDateIndex_);
     }
 }
 
@@ -109,10 +171,13 @@ void DateSelector::gotoPrev() {
         state_ = State::Fetching;
         lock.unlock();
         carousel_->loadingNextFeed();
+        // Keep the date we're moving to from being evicted by the prefetches which are about to follow
+        feedService_->pinFeed(date);
         feedService_->fetchFeed(date, [this](Error error, uint32_t status, std::shared_ptr<Feed> feed) {
             std::lock_guard<std::mutex> lock(mutex_);
             state_ = State::NotifyCarousel;
         });
+        feedService_->prefetchAround(currDateIndex_);
         
     }
 }
@@ -22,6 +22,7 @@
 class DateSelector {
 public:
     DateSelector(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTexService, const std::shared_ptr<FeedService>& feedService, const std::shared_ptr<Carousel>& carousel, int x, int y, bool verbose);
+    ~DateSelector();
     
     bool hasNext();
     bool hasPrev();
@@ -48,8 +49,16 @@ private:
     int     y_;
     int32_t currDateIndex_;
 
-    std::vector<std::shared_ptr<Texture>> dateTex_;
-    
+    // Only the date on screen has its label rasterized, however many dates there are
+    int32_t                     labelIndex_;
+    int32_t                     labelNumGames_;
+    bool                        labelStale_;
+    std::shared_ptr<Texture>    dateTex_;
+    std::shared_ptr<Texture>    gamesTex_;
+    double                      checkTimer_;    // Seconds until the feed and label are checked again
+
+    void updateLabel();
+    void releaseLabel();
     void gotoNext();
     void gotoPrev();
 };
@@ -43,7 +43,7 @@ void DisplayList::addTexture(const std::shared_ptr<Texture>& texture, int x, int
         auto dst = utilities::getPosition(texture, x, y, 0.5, 0.5);
         auto src = SDL_Rect{ 0, 0, static_cast<int>(texture->getWidth()), static_cast<int>(texture->getHeight()) };
         obj.type = DisplayObject::Type::Texture;
-        obj.texture = texture;
+        obj.texture = texture.get();
         obj.src = src;
         obj.dst = dst;
         obj.colorOp = colorOp;
@@ -58,7 +58,7 @@ void DisplayList::addScaledTexture(const std::shared_ptr<Texture>& texture, int
         auto dst = utilities::getScaledPosition(texture, x, y, scaleX, scaleY, 0.5, 0.5);
         auto src = SDL_Rect{ 0, 0, static_cast<int>(texture->getWidth()), static_cast<int>(texture->getHeight()) };
         obj.type = DisplayObject::Type::Texture;
-        obj.texture = texture;
+        obj.texture = texture.get();
         obj.src = src;
         obj.dst = dst;
         obj.colorOp = colorOp;
@@ -73,7 +73,7 @@ void DisplayList::addXformTexture(const std::shared_ptr<Texture>& texture, int x
         auto dst = utilities::getScaledPosition(texture, x, y, scaleX, scaleY, 0.5, 0.5);
         auto src = SDL_Rect{ 0, 0, static_cast<int>(texture->getWidth()), static_cast<int>(texture->getHeight()) };
         obj.type = DisplayObject::Type::Texture;
-        obj.texture = texture;
+        obj.texture = texture.get();
         obj.src = src;
         obj.dst = dst;
         obj.angle = rotate;
@@ -21,7 +21,7 @@ struct DisplayObject {
     uint32_t                    colorOp;
 
     Type                        type;
-    std::shared_ptr<Texture>    texture;
+    Texture                     *texture;   // Not owned, see DisplayList
     double                      angle;
     // Any rotation is center based
     SDL_Rect                    src;
@@ -30,6 +30,8 @@ struct DisplayObject {
 };
 
 // Our display list operates with all elements being center based
+// Textures are not retained. Whoever builds and renders the list holds an EpochReclaimer::ReadGuard for the
+// frame, so a texture removed from its service mid-frame is not freed until the list has been rendered
 class DisplayList {
 public:
     DisplayList(SDL_Renderer *renderer, Color bkgColor);
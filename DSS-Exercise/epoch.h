@@ -9,32 +9,38 @@
 #define epoch_h
 
 #include <chrono>
+#include <atomic>
 
 class EpochTime {
 public:
+    // Shifts all times reported by EpochTime. Used when replaying a recorded session so time dependent
+    // code sees the recording's clock rather than the wall clock
+    static void setOffsetInMicroSec(int64_t offset) {
+        offset_ = offset;
+    }
+
     static int64_t timeInSec() {
-        const auto epoch   = std::chrono::system_clock::now().time_since_epoch();
-        const auto time = std::chrono::duration_cast<std::chrono::seconds>(epoch);
-        return time.count();
+        return timeInMicroSec() / 1000000;
     }
     
     static int64_t timeInMilliSec() {
-        const auto epoch   = std::chrono::system_clock::now().time_since_epoch();
-        const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(epoch);
-        return time.count();
+        return timeInMicroSec() / 1000;
     }
     
     static int64_t timeInMicroSec() {
         const auto epoch   = std::chrono::system_clock::now().time_since_epoch();
         const auto time = std::chrono::duration_cast<std::chrono::microseconds>(epoch);
-        return time.count();
+        return time.count() + offset_;
     }
     
     static int64_t timeInNanoSec() {
         const auto epoch   = std::chrono::system_clock::now().time_since_epoch();
         const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(epoch);
-        return time.count();
+        return time.count() + offset_ * 1000;
     }
+
+private:
+    inline static std::atomic<int64_t> offset_{0};
 };
 
 #endif /* epoch_h */
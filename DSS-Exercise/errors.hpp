@@ -22,7 +22,9 @@ enum class Error : uint32_t {
     HTTPFailed = 6,
     CouldNotCreateResource = 7,
     JSONParseError = 8,
-    EmptyResponse = 9
+    EmptyResponse = 9,
+    CircuitOpen = 10,
+    UnsupportedScheme = 11
 };
 
 #endif /* errors_hpp */
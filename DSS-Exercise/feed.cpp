@@ -7,257 +7,142 @@
 //
 
 #include "feed.hpp"
+#include "jsonFields.h"
+#include "logger.hpp"
 
-#include <iostream>
+#include <algorithm>
 
-static const char *kFeedDataKeyCopyright = "copyright";
-static const char *kFeedDataKeyDates = "dates";
+static constexpr const char *kFeedDataKeyCopyright = "copyright";
+static constexpr const char *kFeedDataKeyDates = "dates";
 
-static const char *kGameDateKeyDate = "date";
-static const char *kGameDateKeyGames = "games";
+static constexpr const char *kGameDateKeyDate = "date";
+static constexpr const char *kGameDateKeyGames = "games";
 
-static const char *kGameKeyGameDate = "gameDate";
-static const char *kGameKeyGamePark = "gamePk";
-static const char *kGameKeyContent = "content";
+static constexpr const char *kGameKeyGameDate = "gameDate";
+static constexpr const char *kGameKeyGamePark = "gamePk";
+static constexpr const char *kGameKeyContent = "content";
 
-static const char *kGameContentKeyEditorial = "editorial";
+static constexpr const char *kGameContentKeyEditorial = "editorial";
 
-static const char *kGameContentEditorialKeyRecap = "recap";
+static constexpr const char *kGameContentEditorialKeyRecap = "recap";
 
-static const char *kGameContentEditorialPerspectiveMLB = "mlb";
+static constexpr const char *kGameContentEditorialPerspectiveMLB = "mlb";
 
-static const char *kGameRecapKeyDate = "date";
-static const char *kGameRecapKeyHeadline = "headline";
-static const char *kGameRecapKeySubhead = "subhead";
-static const char *kGameRecapKeySeoTitle = "seoTitle";
-static const char *kGameRecapKeyBlurb = "blurb";
-static const char *kGameRecapKeyImage = "image";
+static constexpr const char *kGameRecapKeyDate = "date";
+static constexpr const char *kGameRecapKeyHeadline = "headline";
+static constexpr const char *kGameRecapKeySubhead = "subhead";
+static constexpr const char *kGameRecapKeySeoTitle = "seoTitle";
+static constexpr const char *kGameRecapKeyBlurb = "blurb";
+static constexpr const char *kGameRecapKeyImage = "image";
 
-static const char *kGameRecapImageKeyTitle = "title";
-static const char *kGameRecapImageKeyAltText = "altText";
-static const char *kGameRecapImageKeyCuts = "cuts";
+static constexpr const char *kGameRecapImageKeyTitle = "title";
+static constexpr const char *kGameRecapImageKeyAltText = "altText";
+static constexpr const char *kGameRecapImageKeyCuts = "cuts";
 
-static const char *kGameRecapKeyCutKeyAspectRatio = "aspectRatio";
-static const char *kGameRecapKeyCutKeyWidth = "width";
-static const char *kGameRecapKeyCutKeyHeight = "height";
-static const char *kGameRecapKeyCutKeySrc = "src";
-static const char *kGameRecapKeyCutKeyAt2x = "at2x";
-static const char *kGameRecapKeyCutKeyAt3x = "at3x";
+static constexpr const char *kGameRecapKeyCutKeyAspectRatio = "aspectRatio";
+static constexpr const char *kGameRecapKeyCutKeyWidth = "width";
+static constexpr const char *kGameRecapKeyCutKeyHeight = "height";
+static constexpr const char *kGameRecapKeyCutKeySrc = "src";
+static constexpr const char *kGameRecapKeyCutKeyAt2x = "at2x";
+static constexpr const char *kGameRecapKeyCutKeyAt3x = "at3x";
 
-bool GameRecapCut::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameRecapKeyCutKeyAspectRatio)) {
-            aspectRatio = json[kGameRecapKeyCutKeyAspectRatio].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyCutKeyWidth)) {
-            width = json[kGameRecapKeyCutKeyWidth].GetUint();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyCutKeyHeight)) {
-            height = json[kGameRecapKeyCutKeyHeight].GetUint();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyCutKeySrc)) {
-            src1x = json[kGameRecapKeyCutKeySrc].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyCutKeyAt2x)) {
-            src2x = json[kGameRecapKeyCutKeyAt2x].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyCutKeyAt3x)) {
-            src3x = json[kGameRecapKeyCutKeyAt3x].GetString();
-        } else {
-            return false;
-        }
-        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
-}
+// Fields are declared once per struct. See JsonFields for how an object is read
 
-bool GameRecapImage::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameRecapImageKeyTitle)) {
-            title = json[kGameRecapImageKeyTitle].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapImageKeyAltText)) {
-            altText = json[kGameRecapImageKeyAltText].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapImageKeyCuts)) {
-            cuts.clear();
-            
-            auto array = json[kGameRecapImageKeyCuts].GetArray();
-            cuts.reserve(array.Size());
-            for (auto it=array.Begin();it!=array.End();++it) {
-                GameRecapCut cut;
-                if (cut.fromJson(*it)) {
-                    cuts.push_back(std::move(cut));
-                } else {
-                    return false;
-                }
-            }
-        } else {
-            return false;
+static constexpr JsonFields kGameRecapCutFields({
+    jsonField<&GameRecapCut::aspectRatio>(kGameRecapKeyCutKeyAspectRatio),
+    jsonField<&GameRecapCut::width>(kGameRecapKeyCutKeyWidth),
+    jsonField<&GameRecapCut::height>(kGameRecapKeyCutKeyHeight),
+    jsonField<&GameRecapCut::src1x>(kGameRecapKeyCutKeySrc),
+    jsonField<&GameRecapCut::src2x>(kGameRecapKeyCutKeyAt2x),
+    jsonField<&GameRecapCut::src3x>(kGameRecapKeyCutKeyAt3x),
+});
+
+static constexpr JsonFields kGameRecapImageFields({
+    jsonField<&GameRecapImage::title>(kGameRecapImageKeyTitle),
+    jsonField<&GameRecapImage::altText>(kGameRecapImageKeyAltText),
+    jsonField<&GameRecapImage::cuts>(kGameRecapImageKeyCuts),
+});
+
+static constexpr JsonFields kGameRecapFields({
+    jsonField<&GameRecap::date>(kGameRecapKeyDate),
+    jsonField<&GameRecap::headline>(kGameRecapKeyHeadline),
+    jsonField<&GameRecap::subhead>(kGameRecapKeySubhead),
+    jsonField<&GameRecap::seoTitle>(kGameRecapKeySeoTitle),
+    jsonField<&GameRecap::blurb>(kGameRecapKeyBlurb),
+    jsonField<&GameRecap::image>(kGameRecapKeyImage),
+});
+
+static JsonStatus readRecaps(GameContentEditorial& editorial, const rapidjson::Value& json) {
+    if (!json.IsObject()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    editorial.recaps.clear();
+    for (auto it=json.MemberBegin();it!=json.MemberEnd();++it) {
+        GameRecap recap;
+        auto status = recap.fromJson(it->value);
+        if (!status) {
+            return status;
         }
-        return true;
-    } catch (std::exception& e) {
-        return false;
+        editorial.recaps[std::string(it->name.GetString(), it->name.GetStringLength())] = std::move(recap);
+    }
+    // For this assignment, we are working on the assumption that 'mlb' is a required key
+    if (editorial.recaps.find(kGameContentEditorialPerspectiveMLB) == editorial.recaps.end()) {
+        return JsonStatus{JsonError::MissingField, kGameContentEditorialPerspectiveMLB};
     }
+    return JsonStatus();
 }
 
-bool GameRecap::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameRecapKeyDate)) {
-            date = json[kGameRecapKeyDate].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyHeadline)) {
-            headline = json[kGameRecapKeyHeadline].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeySubhead)) {
-            subhead = json[kGameRecapKeySubhead].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeySeoTitle)) {
-            seoTitle = json[kGameRecapKeySeoTitle].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyBlurb)) {
-            blurb = json[kGameRecapKeyBlurb].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameRecapKeyImage)) {
-            if (!image.fromJson(json[kGameRecapKeyImage])) {
-                return false;
-            }
-        } else {
-            return false;
-        }
-        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
+static constexpr JsonFields kGameContentEditorialFields({
+    JsonField<GameContentEditorial>(kGameContentEditorialKeyRecap, &readRecaps),
+});
+
+static constexpr JsonFields kGameContentFields({
+    jsonField<&GameContent::editorial>(kGameContentKeyEditorial),
+});
+
+static constexpr JsonFields kGameFields({
+    jsonField<&Game::gameDate>(kGameKeyGameDate),
+    jsonField<&Game::gamePark>(kGameKeyGamePark),
+    jsonField<&Game::content>(kGameKeyContent),
+});
+
+static constexpr JsonFields kGameDateFields({
+    jsonField<&GameDate::date>(kGameDateKeyDate),
+    // A game we can't read is left out rather than failing the whole date
+    JsonField<GameDate>(kGameDateKeyGames, &readJsonMemberSkippingInvalid<&GameDate::games>),
+});
+
+static constexpr JsonFields kFeedDataFields({
+    jsonField<&FeedData::copyright>(kFeedDataKeyCopyright),
+    jsonField<&FeedData::dates>(kFeedDataKeyDates),
+});
+
+JsonStatus GameRecapCut::fromJson(const rapidjson::Value& json) {
+    return kGameRecapCutFields.read(*this, json);
 }
 
+JsonStatus GameRecapImage::fromJson(const rapidjson::Value& json) {
+    return kGameRecapImageFields.read(*this, json);
+}
 
-bool GameContentEditorial::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameContentEditorialKeyRecap)) {
-            recaps.clear();
-            
-            auto dict = json[kGameContentEditorialKeyRecap].GetObject();
-            for (auto it=dict.MemberBegin();it!=dict.MemberEnd();++it) {
-                GameRecap recap;
-                if (recap.fromJson(it->value)) {
-                    recaps[it->name.GetString()] = recap;
-                } else {
-                    return false;
-                }
-            }
-            // For this assignment, we are working on the assumption that 'mlb' is a required key
-            auto it = recaps.find(kGameContentEditorialPerspectiveMLB);
-            if (it == recaps.end()) {
-                // Fail if 'mlb' does not exist
-                return false;
-            }
-        } else {
-            return false;
-        }
-        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
+JsonStatus GameRecap::fromJson(const rapidjson::Value& json) {
+    return kGameRecapFields.read(*this, json);
 }
 
+JsonStatus GameContentEditorial::fromJson(const rapidjson::Value& json) {
+    return kGameContentEditorialFields.read(*this, json);
+}
 
-bool GameContent::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameContentKeyEditorial)) {
-            if (!editorial.fromJson(json[kGameContentKeyEditorial])) {
-                return false;
-            }
-        } else {
-            return false;
-        }
-        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
+JsonStatus GameContent::fromJson(const rapidjson::Value& json) {
+    return kGameContentFields.read(*this, json);
 }
 
-bool Game::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameKeyGameDate)) {
-            gameDate = json[kGameKeyGameDate].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameKeyGamePark)) {
-            gamePark = json[kGameKeyGamePark].GetUint();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameKeyContent)) {
-            if (!content.fromJson(json[kGameKeyContent])) {
-                return false;
-            }
-        } else {
-            return false;
-        }        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
+JsonStatus Game::fromJson(const rapidjson::Value& json) {
+    return kGameFields.read(*this, json);
 }
 
-bool GameDate::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kGameDateKeyDate)) {
-            date = json[kGameDateKeyDate].GetString();
-        } else {
-            return false;
-        }
-        if (json.HasMember(kGameDateKeyGames)) {
-            games.clear();
-            
-            auto array = json[kGameDateKeyGames].GetArray();
-            games.reserve(array.Size());
-            for (auto it=array.Begin();it!=array.End();++it) {
-                Game game;
-                if (game.fromJson(*it)) {
-                    games.push_back(std::move(game));
-                }
-            }
-        } else {
-            return false;
-        }
-        return true;
-    } catch (std::exception& e) {
-        return false;
-    }
+JsonStatus GameDate::fromJson(const rapidjson::Value& json) {
+    return kGameDateFields.read(*this, json);
 }
 
 uint32_t FeedData::getNumGames() const {
@@ -269,37 +154,72 @@ uint32_t FeedData::getNumGames() const {
     return 0;
 }
 
-bool FeedData::fromJson(const rapidjson::Value& json) {
-    using namespace rapidjson;
-    try {
-        if (json.HasMember(kFeedDataKeyCopyright)) {
-            copyright = json[kFeedDataKeyCopyright].GetString();
-        } else {
-            return false;
+JsonStatus FeedData::fromJson(const rapidjson::Value& json) {
+    return kFeedDataFields.read(*this, json);
+}
+
+FeedGameRecap::FeedGameRecap(const std::string date, uint32_t park, const std::string& headline, const std::string& description, const std::string& thumbnailUrl, std::vector<ThumbnailCut> thumbnailCuts) : date(date), park(park), headline(headline), description(description), thumbnailUrl(thumbnailUrl), thumbnailCuts(std::move(thumbnailCuts)), thumbnailState_(ThumbnailState::Unloaded) {
+}
+
+const std::string& FeedGameRecap::getThumbnailUrl(uint32_t width, uint32_t height) const {
+    if (!width || thumbnailCuts.empty()) {
+        return thumbnailUrl;
+    }
+    for (auto& cut : thumbnailCuts) {
+        if (cut.width >= width && cut.height >= height) {
+            return cut.url;
         }
-        if (json.HasMember(kFeedDataKeyDates)) {
-            dates.clear();
-            
-            auto array = json[kFeedDataKeyDates].GetArray();
-            dates.reserve(array.Size());
-            for (auto it=array.Begin();it!=array.End();++it) {
-                GameDate date;
-                if (date.fromJson(*it)) {
-                    dates.push_back(std::move(date));
-                } else {
-                    return false;
-                }
-            }
-        } else {
-            return false;
+    }
+    return thumbnailCuts.back().url;
+}
+
+bool FeedGameRecap::isThumbnailCut(std::string_view aspectRatio, uint32_t width, uint32_t height) {
+    // Yes these are hard coded right now, these should be passed in as params, but I am not doing that right now
+    return aspectRatio == "16:9" && width == 480 && height == 270;
+}
+
+void FeedGameRecap::addThumbnailCut(std::vector<ThumbnailCut>& cuts, std::string_view aspectRatio, uint32_t width, uint32_t height, std::string_view src, std::string_view at2x, std::string_view at3x) {
+    if (aspectRatio != "16:9" || !width || !height) {
+        return;
+    }
+    std::string_view urls[] = { src, at2x, at3x };
+    for (uint32_t density=1;density<=3;++density) {
+        auto& url = urls[density - 1];
+        if (url.empty()) {
+            continue;
+        }
+        auto cutWidth = width * density;
+        auto it = std::lower_bound(cuts.begin(), cuts.end(), cutWidth, [](const ThumbnailCut& cut, uint32_t width) {
+            return cut.width < width;
+        });
+        // Cuts often overlap, eg. the at2x of 480x270 and the src of 960x540. One of each size is enough
+        if (it == cuts.end() || it->width != cutWidth) {
+            cuts.insert(it, ThumbnailCut{cutWidth, height * density, std::string(url)});
         }
-        return true;
-    } catch (std::exception& e) {
-        return false;
     }
 }
 
-FeedGameRecap::FeedGameRecap(const std::string date, uint32_t park, const std::string& headline, const std::string& description, const std::string& thumbnailUrl) : date(date), park(park), headline(headline), description(description), thumbnailUrl(thumbnailUrl),  thumbnailState_(ThumbnailState::Unloaded) {
+std::string FeedGameRecap::getDescription(std::string_view headline, std::string_view subhead, std::string_view seoTitle, std::string_view blurb) {
+    std::string description;
+    if (subhead.size() && subhead != headline) {
+        // Use subhead
+        description = std::string(subhead);
+    } else if (seoTitle.size() && seoTitle != headline) {
+        // Use SEO Title
+        description = std::string(seoTitle);
+    } else if (blurb.size()){
+        // Blurbs are long, so only take 200 characters and we append an ellipsis
+        // OMG, did I just hard code this value? Yes I did! Bad bad bad :D!
+        if (blurb.size() > 200) {
+            description = std::string(blurb.substr(0, 200));
+            description += "...";
+        } else {
+            description = std::string(blurb);
+        }
+    } else {
+        description = "You're Out! Could not find a valid description.";
+    }
+    return description;
 }
 
 Feed::Feed(const std::string& date, FeedData data) : date_(date) {
@@ -319,50 +239,39 @@ Feed::Feed(const std::string& date, FeedData data) : date_(date) {
                 // First find our image. We are not writing fallback code
                 // We are using 16:9 images which are 480x270. If we do not have a match, we will ignore this
                 std::string thumbnail;
-                for (auto cut : recap.image.cuts) {
-                    // Yes these are hard coded right now, these should be passed in as params, but I am not doing that right now
-                    if (cut.aspectRatio == "16:9" && cut.width == 480 && cut.height == 270) {
+                std::vector<ThumbnailCut> cuts;
+                for (auto& cut : recap.image.cuts) {
+                    if (thumbnail.empty() && FeedGameRecap::isThumbnailCut(cut.aspectRatio, cut.width, cut.height)) {
                         thumbnail = cut.src1x;
-                        break;
                     }
+                    FeedGameRecap::addThumbnailCut(cuts, cut.aspectRatio, cut.width, cut.height, cut.src1x, cut.src2x, cut.src3x);
                 }
                 if (thumbnail.size()) {
                     // Extract headline and then find best description based on fallback
                     auto& headline = recap.headline;    // We assume one always exists
-                    std::string description;
-                    if (recap.subhead.size() && recap.subhead != headline) {
-                        // Use subhead
-                        description = recap.subhead;
-                    } else if (recap.seoTitle.size() && recap.seoTitle != headline) {
-                        // Use SEO Title
-                        description = recap.seoTitle;
-                    } else if (recap.blurb.size()){
-                        // Blurbs are long, so only take 200 characters and we append an ellipsis
-                        // OMG, did I just hard code this value? Yes I did! Bad bad bad :D!
-                        if (recap.blurb.size() > 200) {
-                            description = recap.blurb.substr(0, 200);
-                            description += "...";
-                        } else {
-                            description = recap.blurb;
-                        }
-                    } else {
-                        description = "You're Out! Could not find a valid description.";
-                    }
-                    
-                    recaps_.emplace_back(std::make_shared<FeedGameRecap>(date, park, headline, description, thumbnail));
+                    auto description = FeedGameRecap::getDescription(headline, recap.subhead, recap.seoTitle, recap.blurb);
+                    recaps_.emplace_back(std::make_shared<FeedGameRecap>(date, park, headline, description, thumbnail, std::move(cuts)));
                 } else {
-                    std::cerr << "WARNING: Could not find 16:9 (480x270) image for Game Day " << date << " at park " << park << ". Ignoring..." << std::endl;
+                    Log(LogLevel::Warning) << "WARNING: Could not find 16:9 (480x270) image for Game Day " << date << " at park " << park << ". Ignoring...";
                 }
             } else {
-                std::cerr << "WARNING: Game Day " << date << " at park " << park << " JSON does not contain a \"mlb\" recap. Ignoring..." << std::endl;
+                Log(LogLevel::Warning) << "WARNING: Game Day " << date << " at park " << park << " JSON does not contain a \"mlb\" recap. Ignoring...";
             }
         }
     }
 }
 
+Feed::Feed(const std::string& date, std::vector<std::shared_ptr<FeedGameRecap>> recaps) : date_(date), recaps_(std::move(recaps)) {
+}
+
 Feed::~Feed() {
 }
 
+std::vector<std::shared_ptr<FeedGameRecap>> Feed::getRecaps() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return recaps_;
+}
+
 std::shared_ptr<FeedGameRecap> Feed::getRecapAtIndex(size_t index) const {
     if (index < recaps_.size()) {
         return recaps_[index];
@@ -12,6 +12,7 @@
 #include <stdio.h>
 #include <atomic>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <map>
@@ -19,6 +20,7 @@
 
 #include "json.hpp"
 #include "texture.hpp"
+#include "slotArray.h"
 
 struct GameRecapCut : public JsonSerializer {
     std::string aspectRatio;
@@ -28,7 +30,7 @@ struct GameRecapCut : public JsonSerializer {
     std::string src2x;
     std::string src3x;
 
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct GameRecapImage : public JsonSerializer {
@@ -36,7 +38,7 @@ struct GameRecapImage : public JsonSerializer {
     std::string                 altText;
     std::vector<GameRecapCut>   cuts;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct GameRecap : public JsonSerializer {
@@ -47,19 +49,19 @@ struct GameRecap : public JsonSerializer {
     std::string     blurb;      // Fallback
     GameRecapImage  image;
 
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct GameContentEditorial : public JsonSerializer {
     std::map<std::string, GameRecap>    recaps;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct GameContent : public JsonSerializer {
     GameContentEditorial    editorial;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct Game : public JsonSerializer {
@@ -67,14 +69,14 @@ struct Game : public JsonSerializer {
     uint32_t    gamePark;   //  Game Park is unique key we can use
     GameContent content;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct GameDate : public JsonSerializer {
     std::string         date;
     std::vector<Game>   games;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 struct FeedData : public JsonSerializer {
@@ -88,13 +90,20 @@ struct FeedData : public JsonSerializer {
     // Expected to be used in conjuction with getNumGames()
     Game getGame(uint32_t num) const;
     
-    bool fromJson(const rapidjson::Value& json);
+    JsonStatus fromJson(const rapidjson::Value& json);
 };
 
 class FeedService;
 class Carousel;
 class Feed;
 
+// One size of a recap image. Densities are folded in, so the at2x of a 480x270 cut is a 960x540 ThumbnailCut
+struct ThumbnailCut {
+    uint32_t    width;
+    uint32_t    height;
+    std::string url;
+};
+
 // This is the struct in use with the carousel thumbnail
 struct FeedGameRecap {
     enum class ThumbnailState { Unloaded, Loading, Loaded, Error };
@@ -102,31 +111,60 @@ struct FeedGameRecap {
     uint32_t                    park;
     std::string                 headline;
     std::string                 description;
-    std::string                 thumbnailUrl;
+    std::string                 thumbnailUrl;   // The 480x270 cut. Identifies the image, and is used when there are no cuts
+    std::vector<ThumbnailCut>   thumbnailCuts;  // 16:9 sizes by ascending width
     
     FeedGameRecap() : park(0), thumbnailState_(ThumbnailState::Unloaded) {}
-    FeedGameRecap(const std::string date, uint32_t park, const std::string& headline, const std::string& description, const std::string& thumbnailUrl);
+    FeedGameRecap(const std::string date, uint32_t park, const std::string& headline, const std::string& description, const std::string& thumbnailUrl, std::vector<ThumbnailCut> thumbnailCuts = {});
+
+    // Smallest cut covering width x height pixels, or the largest there is. A width of 0 means thumbnailUrl
+    const std::string& getThumbnailUrl(uint32_t width, uint32_t height) const;
+
+    // Shared by the DOM and SAX parsers so both build identical recaps
+    static bool isThumbnailCut(std::string_view aspectRatio, uint32_t width, uint32_t height);
+    // Adds the cut at each density it has, if it has the thumbnail's aspect ratio
+    static void addThumbnailCut(std::vector<ThumbnailCut>& cuts, std::string_view aspectRatio, uint32_t width, uint32_t height, std::string_view src, std::string_view at2x, std::string_view at3x);
+    static std::string getDescription(std::string_view headline, std::string_view subhead, std::string_view seoTitle, std::string_view blurb);
     
 private:
     friend class Feed;
     friend class FeedService;
     friend class Carousel;
+    friend class BrowseGrid;
     
     std::atomic<ThumbnailState> thumbnailState_;
+    std::atomic<uint64_t>       thumbnail_{0};  // Packed TextureHandle, set before the state goes to Loaded
+    std::atomic<uint64_t>       focusThumbnail_{0}; // Larger cut for while the thumbnail is focused, if it needs one
+    bool                        focusRequested_ = false;    // Guarded by the feed's mutex
+    bool                        thumbnailReleased_ = false; // Guarded by the feed's mutex, see FeedService::releaseThumbnail
+    // Guarded by the feed's mutex. Null unless the carousel has asked for the text
+    SlotHandle                  headlineTex_;
+    SlotHandle                  descriptionTex_;
 
     ThumbnailState getThumbnailState() const { return thumbnailState_; }
     void setThumbnailState(ThumbnailState state) { thumbnailState_ = state; }
+    SlotHandle getThumbnail() const { return SlotHandle::unpack(thumbnail_); }
+    void setThumbnail(SlotHandle handle) { thumbnail_ = handle.pack(); }
+    SlotHandle getFocusThumbnail() const { return SlotHandle::unpack(focusThumbnail_); }
+    void setFocusThumbnail(SlotHandle handle) { focusThumbnail_ = handle.pack(); }
 };
 
 class Feed {
 public:
     Feed() = delete;
     Feed(const std::string& date, FeedData data);
+    Feed(const std::string& date, std::vector<std::shared_ptr<FeedGameRecap>> recaps);
     ~Feed();
     
     std::string getDate() const { return date_; }
     size_t getNumRecaps() const { return recaps_.size(); }
     std::shared_ptr<FeedGameRecap> getRecapAtIndex(size_t index) const;
+    // Copy of the recaps as of now, safe against FeedService patching the feed
+    std::vector<std::shared_ptr<FeedGameRecap>> getRecaps();
+    // Bumped each time FeedService patches the recaps after a refresh
+    uint32_t getVersion() const { return version_; }
+    // Restored from the snapshot and not yet confirmed by the network, or the last refresh failed
+    bool isStale() const { return stale_; }
     
 private:
     friend FeedService;
@@ -134,9 +172,10 @@ private:
     std::string                                 date_;  // Date serves as the primary key for the feed
     std::vector<std::shared_ptr<FeedGameRecap>> recaps_;
     
-    std::mutex                                  mutex_;
-    std::vector<std::shared_ptr<Texture>>       strings_;
-    std::vector<std::shared_ptr<Texture>>       thumbnails_;
+    std::mutex                                  mutex_;     // Guards recaps_ and the texture handles in them
+    bool                                        released_ = false;  // Evicted, its textures have been handed back
+    std::atomic<uint32_t>                       version_{0};
+    std::atomic<bool>                           stale_{false};
 };
 
 
@@ -0,0 +1,583 @@
+//
+//  feedParser.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/11/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "feedParser.hpp"
+#include "jsonStructuralIndex.hpp"
+#include "logger.hpp"
+#include "rapidjson/reader.h"
+#include "rapidjson/error/en.h"
+
+#include <optional>
+
+static const size_t kReaderStackCapacity = 4 * 1024;
+static const size_t kInitialArenaSize = 64 * 1024;
+
+// A MemoryPoolAllocator over a buffer we keep between parses. Clearing a pool frees every chunk except the
+// user buffer, so after each parse we grow the buffer to cover what the parse needed. Once a thread has seen
+// a feed of a given size, parsing another like it allocates nothing
+class ParseArena {
+public:
+    using Allocator = rapidjson::MemoryPoolAllocator<>;
+
+    ParseArena() : buffer_(kInitialArenaSize) {
+        allocator_.emplace(buffer_.data(), buffer_.size());
+    }
+
+    Allocator& get() { return *allocator_; }
+
+    // Nothing allocated from the arena may be in use
+    void recycle() {
+        auto capacity = allocator_->Capacity();
+        if (capacity > buffer_.size()) {
+            allocator_.reset();
+            // Headroom so a slightly bigger feed next time doesn't spill over again
+            buffer_.resize(capacity + capacity / 4);
+            allocator_.emplace(buffer_.data(), buffer_.size());
+        } else {
+            allocator_->Clear();
+        }
+    }
+
+private:
+    std::vector<char>           buffer_;
+    std::optional<Allocator>    allocator_;
+};
+
+enum class ArenaUse { Value, Stack };
+
+// Per thread, which for feeds means per worker
+static ParseArena& getParseArena(ArenaUse use) {
+    thread_local ParseArena valueArena;
+    thread_local ParseArena stackArena;
+    return use == ArenaUse::Value ? valueArena : stackArena;
+}
+
+// Builds FeedGameRecaps straight from SAX events. We track where we are with a stack of the objects/arrays we
+// care about. Anything else is skipped by counting depth. Parsing is in situ, so strings and keys are views
+// into the buffer until we build the recap
+class FeedSaxHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, FeedSaxHandler> {
+public:
+    FeedSaxHandler(const std::string& date) : date_(date), skipDepth_(0), numDates_(0) {}
+
+    std::vector<std::shared_ptr<FeedGameRecap>>& getRecaps() { return recaps_; }
+
+    bool Default() {
+        return true;
+    }
+
+    bool Uint(unsigned value) {
+        if (!skipDepth_ && stack_.size()) {
+            auto node = stack_.back();
+            if (node == Node::Game && isKey("gamePk")) {
+                game_.park = value;
+                game_.hasPark = true;
+            } else if (node == Node::Cut && isKey("width")) {
+                cut_.width = value;
+            } else if (node == Node::Cut && isKey("height")) {
+                cut_.height = value;
+            }
+        }
+        return true;
+    }
+
+    bool Int(int value) {
+        return value >= 0 ? Uint(static_cast<unsigned>(value)) : true;
+    }
+
+    bool String(const char *str, rapidjson::SizeType length, bool copy) {
+        if (!skipDepth_ && stack_.size()) {
+            auto node = stack_.back();
+            if (node == Node::Recap) {
+                if (isKey("headline")) {
+                    game_.headline = std::string_view(str, length);
+                } else if (isKey("subhead")) {
+                    game_.subhead = std::string_view(str, length);
+                } else if (isKey("seoTitle")) {
+                    game_.seoTitle = std::string_view(str, length);
+                } else if (isKey("blurb")) {
+                    game_.blurb = std::string_view(str, length);
+                }
+            } else if (node == Node::Cut) {
+                if (isKey("aspectRatio")) {
+                    cut_.aspectRatio = std::string_view(str, length);
+                } else if (isKey("src")) {
+                    cut_.src = std::string_view(str, length);
+                } else if (isKey("at2x")) {
+                    cut_.at2x = std::string_view(str, length);
+                } else if (isKey("at3x")) {
+                    cut_.at3x = std::string_view(str, length);
+                }
+            }
+        }
+        return true;
+    }
+
+    bool Key(const char *str, rapidjson::SizeType length, bool copy) {
+        if (!skipDepth_) {
+            key_ = std::string_view(str, length);
+        }
+        return true;
+    }
+
+    bool StartObject() {
+        return start(true);
+    }
+
+    bool EndObject(rapidjson::SizeType memberCount) {
+        if (skipDepth_) {
+            --skipDepth_;
+            return true;
+        }
+        auto node = stack_.back();
+        if (node == Node::Game) {
+            finishGame();
+        } else if (node == Node::Cut) {
+            if (game_.thumbnail.empty() && FeedGameRecap::isThumbnailCut(cut_.aspectRatio, cut_.width, cut_.height)) {
+                game_.thumbnail = cut_.src;
+            }
+            FeedGameRecap::addThumbnailCut(game_.cuts, cut_.aspectRatio, cut_.width, cut_.height, cut_.src, cut_.at2x, cut_.at3x);
+        }
+        stack_.pop_back();
+        return true;
+    }
+
+    bool StartArray() {
+        return start(false);
+    }
+
+    bool EndArray(rapidjson::SizeType elementCount) {
+        if (skipDepth_) {
+            --skipDepth_;
+        } else {
+            stack_.pop_back();
+        }
+        return true;
+    }
+
+private:
+    enum class Node { Root, Dates, Date, Games, Game, Content, Editorial, Recaps, Recap, Image, Cuts, Cut };
+
+    struct GameState {
+        bool                hasPark = false;
+        bool                hasRecap = false;
+        uint32_t            park = 0;
+        std::string_view    headline;
+        std::string_view    subhead;
+        std::string_view    seoTitle;
+        std::string_view    blurb;
+        std::string_view    thumbnail;
+        std::vector<ThumbnailCut> cuts;
+
+        void reset() {
+            *this = GameState();
+        }
+    };
+
+    struct CutState {
+        std::string_view    aspectRatio;
+        uint32_t            width = 0;
+        uint32_t            height = 0;
+        std::string_view    src;
+        std::string_view    at2x;
+        std::string_view    at3x;
+
+        void reset() {
+            *this = CutState();
+        }
+    };
+
+    std::string                                 date_;
+    std::vector<std::shared_ptr<FeedGameRecap>> recaps_;
+    std::vector<Node>                           stack_;
+    size_t                                      skipDepth_;
+    size_t                                      numDates_;
+    std::string_view                            key_;
+    GameState                                   game_;
+    CutState                                    cut_;
+
+    bool isKey(const char *key) const {
+        return key_ == key;
+    }
+
+    bool start(bool isObject) {
+        if (skipDepth_) {
+            ++skipDepth_;
+            return true;
+        }
+
+        // Figure out if this is a node we want
+        bool want = false;
+        Node child = Node::Root;
+        if (stack_.empty()) {
+            want = isObject;
+        } else {
+            switch (stack_.back()) {
+                case Node::Root:
+                    want = !isObject && isKey("dates");
+                    child = Node::Dates;
+                    break;
+                case Node::Dates:
+                    // Only the first date
+                    want = isObject && numDates_++ == 0;
+                    child = Node::Date;
+                    break;
+                case Node::Date:
+                    want = !isObject && isKey("games");
+                    child = Node::Games;
+                    break;
+                case Node::Games:
+                    want = isObject;
+                    child = Node::Game;
+                    game_.reset();
+                    break;
+                case Node::Game:
+                    want = isObject && isKey("content");
+                    child = Node::Content;
+                    break;
+                case Node::Content:
+                    want = isObject && isKey("editorial");
+                    child = Node::Editorial;
+                    break;
+                case Node::Editorial:
+                    want = isObject && isKey("recap");
+                    child = Node::Recaps;
+                    break;
+                case Node::Recaps:
+                    // We only care about (and expect) the mlb perspective
+                    want = isObject && isKey("mlb");
+                    child = Node::Recap;
+                    if (want) {
+                        game_.hasRecap = true;
+                    }
+                    break;
+                case Node::Recap:
+                    want = isObject && isKey("image");
+                    child = Node::Image;
+                    break;
+                case Node::Image:
+                    want = !isObject && isKey("cuts");
+                    child = Node::Cuts;
+                    break;
+                case Node::Cuts:
+                    want = isObject;
+                    child = Node::Cut;
+                    cut_.reset();
+                    break;
+                case Node::Cut:
+                    break;
+            }
+        }
+
+        if (want) {
+            stack_.push_back(child);
+        } else {
+            ++skipDepth_;
+        }
+        key_ = std::string_view();
+        return true;
+    }
+
+    void finishGame() {
+        if (!game_.hasPark) {
+            return;
+        }
+        if (!game_.hasRecap) {
+            Log(LogLevel::Warning) << "WARNING: Game Day " << date_ << " at park " << game_.park << " JSON does not contain a \"mlb\" recap. Ignoring...";
+        } else if (game_.thumbnail.empty()) {
+            Log(LogLevel::Warning) << "WARNING: Could not find 16:9 (480x270) image for Game Day " << date_ << " at park " << game_.park << ". Ignoring...";
+        } else {
+            auto description = FeedGameRecap::getDescription(game_.headline, game_.subhead, game_.seoTitle, game_.blurb);
+            recaps_.emplace_back(std::make_shared<FeedGameRecap>(date_, game_.park, std::string(game_.headline), description, std::string(game_.thumbnail), std::move(game_.cuts)));
+        }
+    }
+};
+
+// Null terminates the buffer so it can be parsed in place
+static char *prepareInsitu(std::vector<uint8_t>& buffer) {
+    if (buffer.empty() || buffer.back() != 0) {
+        buffer.push_back(0);
+    }
+    return reinterpret_cast<char *>(buffer.data());
+}
+
+std::pair<Error, std::shared_ptr<Feed>> FeedParser::parseSax(const std::string& date, std::vector<uint8_t>& buffer) {
+    auto& stackArena = getParseArena(ArenaUse::Stack);
+    std::shared_ptr<Feed> feed;
+    Error error = Error::None;
+    {
+        FeedSaxHandler handler(date);
+        rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, ParseArena::Allocator> reader(&stackArena.get(), kReaderStackCapacity);
+        rapidjson::InsituStringStream stream(prepareInsitu(buffer));
+        try {
+            reader.Parse<rapidjson::kParseInsituFlag | rapidjson::kParseStopWhenDoneFlag>(stream, handler);
+            if (reader.HasParseError()) {
+                Log(LogLevel::Error) << "Parse error " << buffer.size() << " " << rapidjson::GetParseError_En(reader.GetParseErrorCode()) << " at " << reader.GetErrorOffset();
+                error = Error::JSONParseError;
+            } else {
+                feed = std::make_shared<Feed>(date, std::move(handler.getRecaps()));
+            }
+        } catch (std::exception& e) {
+            Log(LogLevel::Error) << "Parse exception " << e.what();
+            error = Error::JSONParseError;
+        }
+    }
+    stackArena.recycle();
+    return std::make_pair(error, feed);
+}
+
+static const std::string_view kRecapPath[] = { "editorial", "recap", "mlb" };
+
+// Descends through nested objects following path, then calls func with the cursor on the value found there.
+// Anything off the path is skipped
+template<typename F>
+static void followPath(JsonIndexWalker& walker, const std::string_view *path, size_t length, F func) {
+    if (!length) {
+        func();
+        return;
+    }
+    if (!walker.isObject()) {
+        walker.skipValue();
+        return;
+    }
+    walker.forEachMember([&](std::string_view key) {
+        if (key == path[0]) {
+            followPath(walker, path + 1, length - 1, func);
+        } else {
+            walker.skipValue();
+        }
+    });
+}
+
+// Reads the members of dates[0].games[] which FeedGameRecap needs
+static void walkGame(JsonIndexWalker& walker, const std::string& date, std::vector<std::shared_ptr<FeedGameRecap>>& recaps) {
+    bool hasPark = false;
+    bool hasRecap = false;
+    uint32_t park = 0;
+    std::string headline;
+    std::string subhead;
+    std::string seoTitle;
+    std::string blurb;
+    std::string thumbnail;
+    std::vector<ThumbnailCut> cuts;
+
+    auto walkCut = [&walker, &thumbnail, &cuts]() {
+        std::string aspectRatio;
+        std::string src;
+        std::string at2x;
+        std::string at3x;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        if (!walker.isObject()) {
+            walker.skipValue();
+            return;
+        }
+        walker.forEachMember([&](std::string_view key) {
+            if (key == "aspectRatio") {
+                walker.readString(aspectRatio);
+            } else if (key == "width") {
+                walker.readUint(width);
+            } else if (key == "height") {
+                walker.readUint(height);
+            } else if (key == "src") {
+                walker.readString(src);
+            } else if (key == "at2x") {
+                walker.readString(at2x);
+            } else if (key == "at3x") {
+                walker.readString(at3x);
+            } else {
+                walker.skipValue();
+            }
+        });
+        if (thumbnail.empty() && FeedGameRecap::isThumbnailCut(aspectRatio, width, height)) {
+            thumbnail = src;
+        }
+        FeedGameRecap::addThumbnailCut(cuts, aspectRatio, width, height, src, at2x, at3x);
+    };
+
+    auto walkRecap = [&]() {
+        walker.forEachMember([&](std::string_view key) {
+            if (key == "headline") {
+                walker.readString(headline);
+            } else if (key == "subhead") {
+                walker.readString(subhead);
+            } else if (key == "seoTitle") {
+                walker.readString(seoTitle);
+            } else if (key == "blurb") {
+                walker.readString(blurb);
+            } else if (key == "image" && walker.isObject()) {
+                walker.forEachMember([&](std::string_view key) {
+                    if (key == "cuts" && walker.isArray()) {
+                        walker.forEachElement(walkCut);
+                    } else {
+                        walker.skipValue();
+                    }
+                });
+            } else {
+                walker.skipValue();
+            }
+        });
+    };
+
+    walker.forEachMember([&](std::string_view key) {
+        if (key == "gamePk") {
+            hasPark = walker.readUint(park);
+        } else if (key == "content") {
+            followPath(walker, kRecapPath, sizeof(kRecapPath) / sizeof(kRecapPath[0]), [&]() {
+                if (walker.isObject()) {
+                    hasRecap = true;
+                    walkRecap();
+                } else {
+                    walker.skipValue();
+                }
+            });
+        } else {
+            walker.skipValue();
+        }
+    });
+
+    if (walker.failed() || !hasPark) {
+        return;
+    }
+    if (!hasRecap) {
+        Log(LogLevel::Warning) << "WARNING: Game Day " << date << " at park " << park << " JSON does not contain a \"mlb\" recap. Ignoring...";
+    } else if (thumbnail.empty()) {
+        Log(LogLevel::Warning) << "WARNING: Could not find 16:9 (480x270) image for Game Day " << date << " at park " << park << ". Ignoring...";
+    } else {
+        auto description = FeedGameRecap::getDescription(headline, subhead, seoTitle, blurb);
+        recaps.emplace_back(std::make_shared<FeedGameRecap>(date, park, headline, description, thumbnail, std::move(cuts)));
+    }
+}
+
+// Reads the games of an element of dates[]. If date is empty it is read from the element
+static void walkDate(JsonIndexWalker& walker, std::string& date, std::vector<std::shared_ptr<FeedGameRecap>>& recaps) {
+    bool readDate = date.empty();
+    walker.forEachMember([&](std::string_view key) {
+        if (readDate && key == "date") {
+            walker.readString(date);
+        } else if (key == "games" && walker.isArray()) {
+            walker.forEachElement([&]() {
+                if (walker.isObject()) {
+                    walkGame(walker, date, recaps);
+                } else {
+                    walker.skipValue();
+                }
+            });
+        } else {
+            walker.skipValue();
+        }
+    });
+    // The API puts date ahead of games, but if it didn't the recaps were made without it
+    if (readDate) {
+        for (auto& recap : recaps) {
+            if (recap->date != date) {
+                recap = std::make_shared<FeedGameRecap>(date, recap->park, recap->headline, recap->description, recap->thumbnailUrl, recap->thumbnailCuts);
+            }
+        }
+    }
+}
+
+// Calls func with the cursor on each element of the response's dates[]
+template<typename F>
+static Error walkDates(const std::vector<uint8_t>& buffer, std::vector<uint32_t>& index, F func) {
+    if (!JsonStructuralIndex::build(buffer.data(), buffer.size(), index)) {
+        Log(LogLevel::Error) << "Parse error " << buffer.size() << " unterminated string";
+        return Error::JSONParseError;
+    }
+
+    JsonIndexWalker walker(reinterpret_cast<const char *>(buffer.data()), buffer.size(), index);
+    if (walker.isObject()) {
+        walker.forEachMember([&](std::string_view key) {
+            if (key == "dates" && walker.isArray()) {
+                walker.forEachElement([&]() {
+                    if (walker.isObject()) {
+                        func(walker);
+                    } else {
+                        walker.skipValue();
+                    }
+                });
+            } else {
+                walker.skipValue();
+            }
+        });
+    } else {
+        walker.skipValue();
+    }
+
+    if (walker.failed()) {
+        Log(LogLevel::Error) << "Parse error " << buffer.size() << " malformed structure";
+        return Error::JSONParseError;
+    }
+    return Error::None;
+}
+
+std::pair<Error, std::shared_ptr<Feed>> FeedParser::parseIndexed(const std::string& date, const std::vector<uint8_t>& buffer) {
+    // Reused between parses like the arenas
+    thread_local std::vector<uint32_t> index;
+    std::vector<std::shared_ptr<FeedGameRecap>> recaps;
+    // Only the first date
+    bool first = true;
+    auto error = walkDates(buffer, index, [&](JsonIndexWalker& walker) {
+        if (!first) {
+            walker.skipValue();
+            return;
+        }
+        first = false;
+        std::string feedDate = date;
+        walkDate(walker, feedDate, recaps);
+    });
+    if (error != Error::None) {
+        return std::make_pair(error, nullptr);
+    }
+    return std::make_pair(Error::None, std::make_shared<Feed>(date, std::move(recaps)));
+}
+
+Error FeedParser::parseIndexedRange(const std::vector<uint8_t>& buffer, const std::function<void(const std::string& date, std::shared_ptr<Feed> feed)>& onDate) {
+    // Not the thread local one, onDate may well end up parsing another response on this thread
+    std::vector<uint32_t> index;
+    return walkDates(buffer, index, [&](JsonIndexWalker& walker) {
+        std::string date;
+        std::vector<std::shared_ptr<FeedGameRecap>> recaps;
+        walkDate(walker, date, recaps);
+        // A failed walk may have stopped partway through the date, so its games can't be trusted
+        if (!walker.failed() && !date.empty()) {
+            onDate(date, std::make_shared<Feed>(date, std::move(recaps)));
+        }
+    });
+}
+
+std::pair<Error, std::shared_ptr<Feed>> FeedParser::parseDom(const std::string& date, std::vector<uint8_t>& buffer) {
+    using namespace rapidjson;
+    auto& valueArena = getParseArena(ArenaUse::Value);
+    auto& stackArena = getParseArena(ArenaUse::Stack);
+    std::shared_ptr<Feed> feed;
+    Error error = Error::None;
+    // Rapidjson and parsing can throw
+    try {
+        GenericDocument<UTF8<>, ParseArena::Allocator, ParseArena::Allocator> doc(&valueArena.get(), kReaderStackCapacity, &stackArena.get());
+        doc.ParseInsitu<kParseStopWhenDoneFlag>(prepareInsitu(buffer));
+        if (doc.HasParseError()) {
+            Log(LogLevel::Error) << "Parse error " << buffer.size() << " " << GetParseError_En(doc.GetParseError());
+            error = Error::JSONParseError;
+        } else {
+            FeedData feedData;
+            auto status = feedData.fromJson(doc);
+            if (!status) {
+                // Whatever was read before the bad field is still used, as it always has been
+                Log(LogLevel::Warning) << "Feed " << date << " " << getJsonErrorString(status.error) << " " << (status.field ? status.field : "");
+            }
+            feed = std::make_shared<Feed>(date, std::move(feedData));
+        }
+    } catch (std::exception& e) {
+        Log(LogLevel::Error) << "Parse exception " << e.what();
+        error = Error::JSONParseError;
+    }
+    // Document is gone, so nothing points into the arenas anymore
+    valueArena.recycle();
+    stackArena.recycle();
+    return std::make_pair(error, feed);
+}
@@ -0,0 +1,44 @@
+//
+//  feedParser.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/11/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef feedParser_hpp
+#define feedParser_hpp
+
+#include <stdio.h>
+#include "errors.hpp"
+#include "feed.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+// Turns a schedule response into a Feed for date. Only the first date in the response is used, except by parseIndexedRange.
+// Both parse in situ, so the buffer is modified (and null terminated if it wasn't). Scratch memory comes from
+// per thread arenas which are reused between parses
+class FeedParser {
+public:
+    // Streams the response and builds the FeedGameRecaps directly. Only the fields a recap needs are kept,
+    // everything else in the response (which with editorial(all) is most of it) is skipped over
+    static std::pair<Error, std::shared_ptr<Feed>> parseSax(const std::string& date, std::vector<uint8_t>& buffer);
+
+    // Two stage. Builds a structural index with SIMD (see JsonStructuralIndex), then walks only the members we
+    // need, skipping everything else by jumping through the index. Does not modify the buffer. Only as strict as
+    // the walk needs to be, so malformed JSON in parts we skip goes unnoticed
+    static std::pair<Error, std::shared_ptr<Feed>> parseIndexed(const std::string& date, const std::vector<uint8_t>& buffer);
+
+    // As parseIndexed, for a response covering a range of dates. Walks dates[] once, calling onDate with each date's
+    // Feed as soon as its element has been read, so earlier dates are delivered even if a later one is malformed.
+    // Dates without games aren't in the response at all
+    static Error parseIndexedRange(const std::vector<uint8_t>& buffer, const std::function<void(const std::string& date, std::shared_ptr<Feed> feed)>& onDate);
+
+    // Builds the full FeedData DOM first and then the Feed from that. Kept for comparison
+    static std::pair<Error, std::shared_ptr<Feed>> parseDom(const std::string& date, std::vector<uint8_t>& buffer);
+};
+
+#endif /* feedParser_hpp */
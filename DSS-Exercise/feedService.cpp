@@ -7,38 +7,55 @@
 //
 
 #include "feedService.hpp"
-#include "rapidjson/document.h"
-#include "rapidjson/error/error.h"
-#include "rapidjson/error/en.h"
+#include "feedParser.hpp"
 #include "types.h"
+#include "utilities.hpp"
+#include "logger.hpp"
 
-#include <iostream>
+#include <cmath>
 
 // At the time of this update, the MLB API hydration for `game(content(editorial(recap)))` is broken, returning a "Internal error occurred". I found that using `editorial(all)` will work, though it returns a much larger payload.
 //static const std::string kBaseFeedUrl = "http://statsapi.mlb.com/api/v1/schedule?hydrate=game(content(editorial(recap))),decisions&date=";
 static const std::string kBaseFeedUrl = "http://statsapi.mlb.com/api/v1/schedule?hydrate=game(content(editorial(all))),decisions&date=";
 static const std::string kTrailingFeedQueryParam = "&sportId=1";
+// Same query as kBaseFeedUrl, with startDate=${START}&endDate=${END} in place of date=${DATE}
+static const std::string kBaseRangeFeedUrl = kBaseFeedUrl.substr(0, kBaseFeedUrl.rfind("date=")) + "startDate=";
+static const std::string kRangeFeedEndDateParam = "&endDate=";
+// Roughly how many thumbnails the carousel shows at once
+static const size_t kNumVisibleThumbnails = 5;
+// Dates on either side of the current one to prefetch
+static const uint32_t kDefaultPrefetchRadius = 1;
+// Enough for the current date, its prefetched neighbours and a couple of dates of history
+static const size_t kDefaultMaxCachedFeeds = 5;
+static const size_t kDefaultMaxCacheBytes = 64 * 1024 * 1024;
+// Textures are decoded to RGBA
+static const size_t kBytesPerPixel = 4;
+// How often the feed on screen is refetched, 0 to never refresh
+static const int64_t kDefaultRefreshInterval = 5 * 60 * 1000;
 
-FeedService::FeedService(const std::shared_ptr<ResourceFetcherService>& fetcher, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, int wrapLimit, bool verbose) : fetcher_(fetcher), textureService_(texService), fontTextService_(fontTextService), wrapLimit_(wrapLimit), verbose_(verbose) {
+FeedService::FeedService(const std::shared_ptr<ResourceFetcherService>& fetcher, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<DateIndex>& dates, const std::string& defaultDate, int wrapLimit, bool verbose) : verbose_(verbose), fetcher_(fetcher), textureService_(texService), fontTextService_(fontTextService), wrapLimit_(wrapLimit), prefetchRadius_(kDefaultPrefetchRadius), thumbnailWidth_(0), thumbnailHeight_(0), unfocusedScale_(1.0), thumbnailsOnDemand_(false), dates_(dates), maxCachedFeeds_(kDefaultMaxCachedFeeds), maxCacheBytes_(kDefaultMaxCacheBytes), evictions_(0), refreshInterval_(kDefaultRefreshInterval) {
     headlineFont_ = FontTextService::Font::Roboto22;
     descriptionFont_ = FontTextService::Font::Roboto20;
     
-    dates_ = {
-        "2022-05-01",
-        "2022-05-02",
-        "2022-05-03",
-        "2022-05-04",
-        "2022-05-05",
-        "2022-05-06",
-        "2022-05-07"
-    };
-    
-    defaultDateIndex_ = static_cast<int32_t>(dates_.size() / 2);
+    auto index = dates_->findDate(defaultDate);
+    if (index < 0) {
+        int32_t day = 0;
+        int32_t firstDay = 0;
+        DateIndex::parseDate(dates_->getDate(0), firstDay);
+        // Before the range, or not a date at all, starts at the beginning
+        index = DateIndex::parseDate(defaultDate, day) && day > firstDay ? static_cast<int64_t>(dates_->size()) - 1 : 0;
+        Log(LogLevel::Warning) << "Default date " << defaultDate << " is outside " << dates_->getDate(0) << " to " << dates_->getDate(dates_->size() - 1) << ", using " << dates_->getDate(static_cast<size_t>(index));
+    }
+    defaultDateIndex_ = static_cast<int32_t>(index);
+    pinnedDate_ = dates_->getDate(defaultDateIndex_);
 }
 
 FeedService::~FeedService() {
     std::lock_guard<std::mutex> lock(mutex_);
     feeds_.clear();
+    published_.clear();
+    lru_.clear();
+    pending_.clear();
     fetcher_ = nullptr;
     textureService_ = nullptr;
 }
@@ -55,8 +72,13 @@ std::string FeedService::getThumbnailKeyForRecap(const std::string& date, size_t
     return date + "-" + std::to_string(recap) + "-thumbnail";
 }
 
+std::string FeedService::getFeedHostUrl() {
+    auto schemeEnd = kBaseFeedUrl.find("://") + 3;
+    return kBaseFeedUrl.substr(0, schemeEnd) + utilities::getHostFromUrl(kBaseFeedUrl);
+}
+
 std::string FeedService::getDefaultDate() const {
-    return std::string(dates_[defaultDateIndex_]);
+    return dates_->getDate(defaultDateIndex_);
 }
 
 int32_t FeedService::getDefaultDateIndex() const {
@@ -64,125 +86,794 @@ int32_t FeedService::getDefaultDateIndex() const {
 }
 
 size_t FeedService::getNumDates() const {
-    return dates_.size();
+    return dates_->size();
 }
 
 std::string FeedService::getDateAtIndex(size_t index) const {
-    if (index < dates_.size()) {
-        return dates_[index];
-    }
-    return std::string();
+    return dates_->getDate(index);
 }
 
 
 void FeedService::fetchFeed(const std::string& date, std::function<void(Error error, uint32_t status, std::shared_ptr<Feed>)> callback)  {
-    auto existing = getFeed(date);
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::shared_ptr<Feed> existing;
+    auto it = feeds_.find(date);
+    if (it != feeds_.end()) {
+        existing = it->second.feed;
+        touchFeed(it->second);
+    }
+    auto pending = pending_.find(date);
+    auto prefetched = prefetched_.find(date);
+    if (prefetched != prefetched_.end() && (existing || pending != pending_.end())) {
+        prefetched->second.hit = true;
+    }
+
     if (existing) {
+        lock.unlock();
+        // A prefetched feed only has its first few thumbnails, get the rest now that it is being looked at
+        loadThumbnails(existing, false);
         if (callback) {
             // 200 for HTTP Status Code OK
             callback(Error::None, 200, existing);
         }
+    } else if (pending != pending_.end()) {
+        // Already on its way, most likely from a prefetch. We can't reprioritize it, but we can piggyback on it
+        pending->second.demanded = true;
+        pending->second.callbacks.push_back(callback);
     } else {
+        pending_[date].demanded = true;
+        lock.unlock();
+
+        // Show what we had last time straight away. The request below brings it up to date
+        auto restored = restoreFeed(date);
+        if (restored) {
+            loadThumbnails(restored, false);
+            trimCache();
+            if (callback) {
+                callback(Error::None, 200, restored);
+            }
+        } else {
+            lock.lock();
+            pending_[date].callbacks.push_back(callback);
+            lock.unlock();
+        }
+
         // Make local copy to capture
         std::string feedDate = date;
-        fetcher_->add(getFeedUrl(feedDate), [this, feedDate, callback](Error error, uint32_t status, const std::vector<uint8_t> buffer) {
-            std::shared_ptr<Feed> feed;
-            if (error == Error::None) {
-                using namespace rapidjson;
-                // Rapidjson and parsing can throw
-                try {
-                    auto doc = rapidjson::Document();
-                    std::string str(buffer.begin(), buffer.end());
-                    doc.Parse<kParseStopWhenDoneFlag>(reinterpret_cast<const char *>(buffer.data()));
-                    if (!doc.HasParseError()) {
-                        FeedData data;
-                        data.fromJson(doc);
-                        
-                        std::unique_lock<std::mutex> lock(mutex_);
-                        auto feed = std::make_shared<Feed>(feedDate, data);
-                        std::lock_guard<std::mutex> feedLock(feed->mutex_);
-                        feeds_[feedDate] = feed;
-                        lock.unlock();
-                        
-                        // Let's now build all the strings we need
-                        // We do this in a two pass system for now, mainly to just stack the different types more cleanly
-                        auto numRecaps = feed->getNumRecaps();
-                        Color white{0xFF, 0xFF, 0xFF, 0xFF};
-                        for (decltype(numRecaps) i=0;i<numRecaps;++i) {
-                            auto recap = feed->getRecapAtIndex(i);
-                            // Key for headlines is date-index-headline
-                            auto key = FeedService::getHeadlineKeyForRecap(feedDate, recap->park);
-                            auto tex = fontTextService_->addString(headlineFont_, key, recap->headline, white, wrapLimit_);
-                            feed->strings_.push_back(tex);
-                            key = FeedService::getDescriptionKeyForRecap(feedDate, recap->park);
-                            tex = fontTextService_->addString(descriptionFont_, key, recap->description, white, wrapLimit_);
-                            feed->strings_.push_back(tex);
-                            key = FeedService::getThumbnailKeyForRecap(feedDate, recap->park);
-                            recap->thumbnailState_ = FeedGameRecap::ThumbnailState::Loading;
-                            textureService_->createTexture(key, recap->thumbnailUrl, [key, recap](Error error, std::shared_ptr<Texture> texture) {
-                                recap->setThumbnailState(error == Error::None ? FeedGameRecap::ThumbnailState::Loaded : FeedGameRecap::ThumbnailState::Error);
-                            });
-                        }
-                        // Now let's prime to all our thumbs to load
-                    } else {
-                        std::cerr << "Parse error " << buffer.size() << " " << GetParseError_En(doc.GetParseError()) << std::endl;
-                        std::string str(buffer.begin(), buffer.end());
-                        std::cout << str << std::endl;
-                        error = Error::JSONParseError;
+        fetcher_->add(getFeedUrl(feedDate), [this, feedDate](Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+            onFeedFetched(feedDate, error, status, buffer);
+        }, restored ? FetchPriority::Normal : FetchPriority::High);
+    }
+}
+
+void FeedService::fetchFeeds(const std::string& startDate, const std::string& endDate, std::function<void(Error error, uint32_t status, std::shared_ptr<Feed>)> callback, FetchPriority priority) {
+    int32_t firstDay = 0;
+    int32_t lastDay = 0;
+    if (!DateIndex::parseDate(startDate, firstDay) || !DateIndex::parseDate(endDate, lastDay) || lastDay < firstDay) {
+        Log(LogLevel::Warning) << "Invalid feed date range " << startDate << " to " << endDate;
+        if (callback) {
+            callback(Error::NoResourceName, 0, nullptr);
+        }
+        return;
+    }
+
+    std::vector<std::shared_ptr<Feed>> existing;
+    std::vector<std::string> missing;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto day=firstDay;day<=lastDay;++day) {
+        auto date = DateIndex::formatDate(day);
+        auto it = feeds_.find(date);
+        auto pending = pending_.find(date);
+        auto prefetched = prefetched_.find(date);
+        if (prefetched != prefetched_.end() && (it != feeds_.end() || pending != pending_.end())) {
+            prefetched->second.hit = true;
+        }
+        if (it != feeds_.end()) {
+            touchFeed(it->second);
+            existing.push_back(it->second.feed);
+        } else if (pending != pending_.end()) {
+            pending->second.demanded = true;
+            pending->second.callbacks.push_back(callback);
+        } else {
+            pending_[date].demanded = true;
+            missing.push_back(date);
+        }
+    }
+    lock.unlock();
+
+    for (auto& feed : existing) {
+        loadThumbnails(feed, false);
+        if (callback) {
+            callback(Error::None, 200, feed);
+        }
+    }
+    for (auto& date : missing) {
+        // As fetchFeed, the snapshot answers straight away and the request brings it up to date
+        auto restored = restoreFeed(date);
+        if (restored) {
+            loadThumbnails(restored, false);
+            if (callback) {
+                callback(Error::None, 200, restored);
+            }
+        } else {
+            lock.lock();
+            pending_[date].callbacks.push_back(callback);
+            lock.unlock();
+        }
+    }
+    trimCache();
+    fetchRanges(missing, priority);
+}
+
+void FeedService::setSnapshot(const std::shared_ptr<FeedSnapshot>& snapshot) {
+    snapshot_ = snapshot;
+}
+
+std::shared_ptr<Feed> FeedService::restoreFeed(const std::string& date) {
+    auto restored = snapshot_ ? snapshot_->getFeed(date) : nullptr;
+    if (restored) {
+        // Stale until the network has had its say
+        restored->stale_ = true;
+        cacheFeed(date, restored, snapshot_->getSavedTime(date));
+    }
+    return restored;
+}
+
+void FeedService::setRefreshInterval(int64_t interval) {
+    refreshInterval_ = interval;
+}
+
+void FeedService::refreshFeed(const std::string& date) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = feeds_.find(date);
+    if (it == feeds_.end() || pending_.find(date) != pending_.end()) {
+        return;
+    }
+    // Also paces retries if the refresh fails
+    it->second.refreshedAt = EpochTime::timeInMilliSec();
+    pending_[date].demanded = true;
+    lock.unlock();
+
+    std::string feedDate = date;
+    fetcher_->add(getFeedUrl(feedDate), [this, feedDate](Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+        onFeedFetched(feedDate, error, status, buffer);
+    }, FetchPriority::Normal);
+}
+
+void FeedService::refreshIfStale(const std::string& date) {
+    if (!refreshInterval_) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = feeds_.find(date);
+    bool stale = it != feeds_.end() && EpochTime::timeInMilliSec() - it->second.refreshedAt >= refreshInterval_;
+    lock.unlock();
+    if (stale) {
+        refreshFeed(date);
+    }
+}
+
+void FeedService::setPrefetchRadius(uint32_t radius) {
+    prefetchRadius_ = radius;
+}
+
+void FeedService::prefetchAround(size_t dateIndex) {
+    // Runs of neighbouring dates go out as one ranged request
+    std::vector<std::string> dates;
+    auto first = dateIndex - std::min<size_t>(dateIndex, prefetchRadius_);
+    for (auto index=first;index<=dateIndex + prefetchRadius_ && index<dates_->size();++index) {
+        auto date = getDateAtIndex(index);
+        if (index != dateIndex && startPrefetch(date)) {
+            dates.push_back(date);
+        }
+    }
+    fetchRanges(dates, FetchPriority::Prefetch);
+}
+
+FeedService::PrefetchStats FeedService::getPrefetchStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PrefetchStats stats{};
+    for (auto& it : prefetched_) {
+        stats.feeds++;
+        stats.bytes += it.second.bytes;
+        if (it.second.hit) {
+            stats.hits++;
+        } else {
+            stats.wastedBytes += it.second.bytes;
+        }
+    }
+    stats.hitRatio = stats.feeds ? static_cast<double>(stats.hits) / stats.feeds : 0.0;
+    return stats;
+}
+
+bool FeedService::startPrefetch(const std::string& date) {
+    // Don't pile speculative work onto a host we already know is down
+    if (!fetcher_->isHostAvailable(getFeedUrl(date))) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (feeds_.find(date) != feeds_.end() || pending_.find(date) != pending_.end()) {
+        return false;
+    }
+    pending_[date].prefetched = true;
+    prefetched_[date] = PrefetchRecord();
+    lock.unlock();
+
+    auto restored = restoreFeed(date);
+    if (restored) {
+        loadThumbnails(restored, true);
+        trimCache();
+    }
+    return true;
+}
+
+void FeedService::fetchRanges(const std::vector<std::string>& dates, FetchPriority priority) {
+    size_t start = 0;
+    for (size_t i=0;i<dates.size();++i) {
+        int32_t day = 0;
+        DateIndex::parseDate(dates[i], day);
+        bool endsRun = i + 1 == dates.size();
+        if (!endsRun) {
+            int32_t nextDay = 0;
+            DateIndex::parseDate(dates[i + 1], nextDay);
+            endsRun = nextDay != day + 1;
+        }
+        if (!endsRun) {
+            continue;
+        }
+
+        if (start == i) {
+            // Keep the single date request, which is what the recorded sessions and the http cache have
+            std::string feedDate = dates[i];
+            fetcher_->add(getFeedUrl(feedDate), [this, feedDate](Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+                onFeedFetched(feedDate, error, status, buffer);
+            }, priority);
+        } else {
+            std::vector<std::string> run(dates.begin() + start, dates.begin() + i + 1);
+            fetcher_->add(getFeedRangeUrl(run.front(), run.back()), [this, run, priority](Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+                onFeedsFetched(run, priority, error, status, buffer);
+            }, priority);
+        }
+        start = i + 1;
+    }
+}
+
+void FeedService::onFeedFetched(const std::string& date, Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+    std::shared_ptr<Feed> parsed;
+    if (error == Error::None) {
+        // Parse straight to recaps, no intermediate DOM. The indexed parser is the fastest but only checks
+        // the parts of the response it reads, so if it is unhappy let the stricter SAX parser have a go
+        std::tie(error, parsed) = FeedParser::parseIndexed(date, buffer);
+        if (error != Error::None) {
+            std::tie(error, parsed) = FeedParser::parseSax(date, buffer);
+        }
+        if (!parsed) {
+            Log(LogLevel::Debug) << Logger::truncate(buffer, Logger::kMaxMessageLength);
+        }
+    }
+    completeFetch(date, error, status, parsed, buffer.size());
+}
+
+void FeedService::onFeedsFetched(const std::vector<std::string>& dates, FetchPriority priority, Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+    // Each date's share of the response, for the prefetch stats
+    auto bytes = buffer.size() / dates.size();
+    std::unordered_set<std::string> remaining(dates.begin(), dates.end());
+    if (error == Error::None) {
+        error = FeedParser::parseIndexedRange(buffer, [this, &remaining, status, bytes](const std::string& date, std::shared_ptr<Feed> feed) {
+            // A range response only has dates we asked for, but don't trust it
+            if (remaining.erase(date)) {
+                completeFetch(date, Error::None, status, feed, bytes);
+            }
+        });
+        if (error != Error::None) {
+            Log(LogLevel::Debug) << Logger::truncate(buffer, Logger::kMaxMessageLength);
+            // The SAX parser only reads the first date of a response, so the rest go out as single requests. They
+            // are still in pending_, so anyone waiting on them gets the result
+            for (auto& date : dates) {
+                if (remaining.find(date) != remaining.end()) {
+                    fetcher_->add(getFeedUrl(date), [this, date](Error error, uint32_t status, std::vector<uint8_t>& buffer) {
+                        onFeedFetched(date, error, status, buffer);
+                    }, priority);
+                }
+            }
+            return;
+        }
+    }
+    for (auto& date : dates) {
+        if (remaining.find(date) == remaining.end()) {
+            continue;
+        }
+        if (error == Error::None) {
+            // Dates without games are left out of the response
+            completeFetch(date, error, status, std::make_shared<Feed>(date, std::vector<std::shared_ptr<FeedGameRecap>>()), bytes);
+        } else {
+            completeFetch(date, error, status, nullptr, bytes);
+        }
+    }
+}
+
+void FeedService::completeFetch(const std::string& date, Error error, uint32_t status, const std::shared_ptr<Feed>& parsed, size_t bytes) {
+    std::shared_ptr<Feed> feed;
+    if (parsed) {
+        // A refresh, or a feed restored from the snapshot. Only what changed is rebuilt
+        auto cached = getFeed(date);
+        bool changed = false;
+        if (cached && patchFeed(cached, parsed, changed)) {
+            feed = cached;
+            dates_->setNumGames(date, static_cast<uint32_t>(parsed->getNumRecaps()));
+            if (changed) {
+                Log(LogLevel::Info) << "Feed for " << date << " changed, now version " << feed->getVersion();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = feeds_.find(date);
+            if (it != feeds_.end()) {
+                it->second.refreshedAt = EpochTime::timeInMilliSec();
+            }
+        } else {
+            feed = parsed;
+            cacheFeed(date, feed, EpochTime::timeInMilliSec());
+        }
+        feed->stale_ = false;
+        if (snapshot_) {
+            snapshot_->store(feed);
+        }
+    } else {
+        // Keep serving whatever we have for the date, most likely restored from the snapshot, rather than nothing.
+        // With the circuit open the fetcher failed fast because the feed host is down
+        feed = getFeed(date);
+        if (feed) {
+            feed->stale_ = true;
+            // Paces the retries refreshIfStale makes, a restored feed's refresh time is when it was saved
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = feeds_.find(date);
+            if (it != feeds_.end()) {
+                it->second.refreshedAt = EpochTime::timeInMilliSec();
+            }
+        }
+        auto reason = error == Error::CircuitOpen ? "Feed host unavailable for " : "Could not revalidate feed for ";
+        Log(LogLevel::Info) << reason << date << (feed ? ", serving stale feed" : ", no cached feed");
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    PendingFetch fetch = std::move(pending_[date]);
+    pending_.erase(date);
+    if (fetch.prefetched) {
+        prefetched_[date].bytes += bytes;
+    }
+    lock.unlock();
+
+    if (feed) {
+        // Once someone has asked for a prefetched feed it is no longer speculative
+        loadThumbnails(feed, !fetch.demanded);
+        trimCache();
+    }
+    for (auto& callback : fetch.callbacks) {
+        if (callback) {
+            callback(error, status, feed);
+        }
+    }
+}
+
+void FeedService::cacheFeed(const std::string& date, const std::shared_ptr<Feed>& feed, int64_t refreshedAt) {
+    std::shared_ptr<Feed> replaced;
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::lock_guard<std::mutex> feedLock(feed->mutex_);
+    auto existing = feeds_.find(date);
+    if (existing != feeds_.end()) {
+        replaced = existing->second.feed;
+        lru_.erase(existing->second.lru);
+    }
+    lru_.push_front(date);
+    feeds_[date] = CachedFeed{feed, lru_.begin(), refreshedAt};
+    published_.insert(date, feed);
+    dates_->setCached(date, true);
+    dates_->setNumGames(date, static_cast<uint32_t>(feed->recaps_.size()));
+    lock.unlock();
+
+    if (replaced) {
+        // Nothing else will hand back its strings and thumbnails
+        releaseFeed(replaced);
+    }
+}
+
+bool FeedService::patchFeed(const std::shared_ptr<Feed>& feed, const std::shared_ptr<Feed>& parsed, bool& changed) {
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    if (feed->released_) {
+        return false;
+    }
+
+    auto date = feed->getDate();
+    std::unordered_map<uint32_t, std::shared_ptr<FeedGameRecap>> previous;
+    for (auto& recap : feed->recaps_) {
+        previous[recap->park] = recap;
+    }
+
+    changed = parsed->recaps_.size() != feed->recaps_.size();
+    std::vector<std::shared_ptr<FeedGameRecap>> recaps;
+    for (size_t i=0;i<parsed->recaps_.size();++i) {
+        auto& incoming = parsed->recaps_[i];
+        std::shared_ptr<FeedGameRecap> existing;
+        auto it = previous.find(incoming->park);
+        if (it != previous.end()) {
+            existing = it->second;
+            previous.erase(it);
+        }
+
+        if (existing && existing->headline == incoming->headline && existing->description == incoming->description && existing->thumbnailUrl == incoming->thumbnailUrl) {
+            recaps.push_back(existing);
+            changed = changed || feed->recaps_[i] != existing;
+            continue;
+        }
+
+        // Recaps are shared with the carousel, so a changed game gets a new recap rather than being modified in place
+        changed = true;
+        if (existing && existing->thumbnailUrl == incoming->thumbnailUrl) {
+            // Keep the thumbnail. If it is still loading, its callback finds this recap by park
+            incoming->setThumbnail(existing->getThumbnail());
+            incoming->setThumbnailState(existing->getThumbnailState());
+            incoming->setFocusThumbnail(existing->getFocusThumbnail());
+            incoming->focusRequested_ = existing->focusRequested_;
+            incoming->thumbnailReleased_ = existing->thumbnailReleased_;
+            existing->setThumbnail(SlotHandle());
+            existing->setFocusThumbnail(SlotHandle());
+            existing->focusRequested_ = false;
+        } else if (existing) {
+            removeThumbnail(existing);
+        }
+        if (existing && existing->headline == incoming->headline && existing->description == incoming->description) {
+            std::swap(incoming->headlineTex_, existing->headlineTex_);
+            std::swap(incoming->descriptionTex_, existing->descriptionTex_);
+        } else if (existing) {
+            // Rasterized again when the carousel asks for the new recap's text
+            removeRecapStrings(existing);
+        }
+        recaps.push_back(incoming);
+    }
+
+    // Whatever is left are games which have dropped out of the feed
+    for (auto& it : previous) {
+        changed = true;
+        removeRecapStrings(it.second);
+        removeThumbnail(it.second);
+    }
+
+    if (changed) {
+        feed->recaps_ = std::move(recaps);
+        feed->version_++;
+    }
+    return true;
+}
+
+FeedService::RecapText FeedService::acquireRecapText(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap) {
+    RecapText text;
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    // Nothing for a feed which has been released or a recap a refresh has replaced, they'd never be cleaned up
+    if (feed->released_ || std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) == feed->recaps_.end()) {
+        return text;
+    }
+    Color white{0xFF, 0xFF, 0xFF, 0xFF};
+    if (!recap->headlineTex_) {
+        recap->headlineTex_ = fontTextService_->addString(headlineFont_, recap->headline, white, wrapLimit_, verbose_ ? FeedService::getHeadlineKeyForRecap(feed->getDate(), recap->park) : std::string());
+    }
+    if (!recap->descriptionTex_) {
+        recap->descriptionTex_ = fontTextService_->addString(descriptionFont_, recap->description, white, wrapLimit_, verbose_ ? FeedService::getDescriptionKeyForRecap(feed->getDate(), recap->park) : std::string());
+    }
+    text.headline = textureService_->getTexture(recap->headlineTex_);
+    text.description = textureService_->getTexture(recap->descriptionTex_);
+    return text;
+}
+
+void FeedService::releaseRecapText(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap) {
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    if (!feed->released_ && std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) != feed->recaps_.end()) {
+        removeRecapStrings(recap);
+    }
+}
+
+void FeedService::removeRecapStrings(const std::shared_ptr<FeedGameRecap>& recap) {
+    fontTextService_->removeString(recap->headlineTex_);
+    fontTextService_->removeString(recap->descriptionTex_);
+    recap->headlineTex_ = SlotHandle();
+    recap->descriptionTex_ = SlotHandle();
+}
+
+void FeedService::removeThumbnail(const std::shared_ptr<FeedGameRecap>& recap) {
+    textureService_->removeTexture(recap->getThumbnail());
+    recap->setThumbnail(SlotHandle());
+    removeFocusThumbnail(recap);
+}
+
+void FeedService::removeFocusThumbnail(const std::shared_ptr<FeedGameRecap>& recap) {
+    textureService_->removeTexture(recap->getFocusThumbnail());
+    recap->setFocusThumbnail(SlotHandle());
+    recap->focusRequested_ = false;
+}
+
+void FeedService::setThumbnailSize(uint32_t width, uint32_t height, double unfocusedScale) {
+    thumbnailWidth_ = width;
+    thumbnailHeight_ = height;
+    unfocusedScale_ = unfocusedScale;
+}
+
+const std::string& FeedService::getThumbnailUrl(const std::shared_ptr<FeedGameRecap>& recap, bool focused) const {
+    double scale = focused ? 1.0 : unfocusedScale_.load();
+    // Rounded rather than ceiled, a scale like 0.66667 would otherwise turn an exact 320x180 cut into 321x181 and
+    // skip it for the next size up
+    return recap->getThumbnailUrl(static_cast<uint32_t>(std::lround(thumbnailWidth_ * scale)), static_cast<uint32_t>(std::lround(thumbnailHeight_ * scale)));
+}
+
+void FeedService::focusThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap) {
+    std::unique_lock<std::mutex> lock(feed->mutex_);
+    if (feed->released_ || recap->focusRequested_) {
+        return;
+    }
+    auto& url = getThumbnailUrl(recap, true);
+    // The unfocused cut already covers it. Checked before the recap is looked up, since the carousel retries
+    if (url == getThumbnailUrl(recap, false) || std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) == feed->recaps_.end()) {
+        return;
+    }
+    recap->focusRequested_ = true;
+    lock.unlock();
+
+    auto date = feed->getDate();
+    std::weak_ptr<Feed> weakFeed = feed;
+    textureService_->loadTexture(url, [this, recap, weakFeed](Error error, TextureHandle handle, std::shared_ptr<Texture> texture) {
+        // Same ownership rules as loadThumbnails. A failed upgrade leaves the unfocused cut showing, and is asked
+        // for again by the next focusThumbnail
+        bool owned = false;
+        auto feed = weakFeed.lock();
+        if (feed && !handle) {
+            std::lock_guard<std::mutex> lock(feed->mutex_);
+            for (auto& current : feed->recaps_) {
+                if (current->park == recap->park && current->thumbnailUrl == recap->thumbnailUrl) {
+                    if (!current->getFocusThumbnail()) {
+                        current->focusRequested_ = false;
                     }
-                } catch (std::exception& e) {
-                    std::cerr << "Parse exception " << e.what() << std::endl;
-                    error = Error::JSONParseError;
+                    break;
                 }
             }
-            
-            if (callback) {
-                callback(error, status, feed);
+        } else if (feed) {
+            std::lock_guard<std::mutex> lock(feed->mutex_);
+            for (auto& current : feed->recaps_) {
+                if (current->park == recap->park && current->thumbnailUrl == recap->thumbnailUrl) {
+                    // Released, or focused again and already upgraded, while we were loading
+                    if (!feed->released_ && current->focusRequested_ && !current->getFocusThumbnail()) {
+                        current->setFocusThumbnail(handle);
+                        owned = true;
+                    }
+                    break;
+                }
             }
-        });
+        }
+        if (!owned) {
+            textureService_->removeTexture(handle);
+        }
+    }, FetchPriority::High, verbose_ ? FeedService::getThumbnailKeyForRecap(date, recap->park) + "-focus" : std::string());
+}
+
+void FeedService::releaseFocusThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap) {
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    if (!feed->released_ && std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) != feed->recaps_.end()) {
+        removeFocusThumbnail(recap);
+    }
+}
+
+void FeedService::loadThumbnails(const std::shared_ptr<Feed>& feed, bool prefetch) {
+    // Whoever shows the feed acquires the thumbnails it needs. A prefetch still warms the first few, which are the
+    // first the carousel will acquire
+    if (thumbnailsOnDemand_ && !prefetch) {
+        return;
+    }
+    auto recaps = feed->getRecaps();
+    // A prefetch only warms what will be on screen first, the rest follow if the user moves to the date
+    auto numThumbnails = prefetch ? std::min(recaps.size(), kNumVisibleThumbnails) : recaps.size();
+    for (decltype(numThumbnails) i=0;i<numThumbnails;++i) {
+        // Thumbnails which will be on screen as soon as the feed shows go first
+        auto priority = prefetch ? FetchPriority::Prefetch : (i < kNumVisibleThumbnails ? FetchPriority::High : FetchPriority::Normal);
+        loadThumbnail(feed, recaps[i], priority, prefetch);
+    }
+}
+
+void FeedService::loadThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority, bool prefetch) {
+    auto unloaded = FeedGameRecap::ThumbnailState::Unloaded;
+    if (!recap->thumbnailState_.compare_exchange_strong(unloaded, FeedGameRecap::ThumbnailState::Loading)) {
+        return;
+    }
+    auto date = feed->getDate();
+    std::weak_ptr<Feed> weakFeed = feed;
+    textureService_->loadTexture(getThumbnailUrl(recap, false), [this, date, recap, weakFeed, prefetch](Error error, TextureHandle handle, std::shared_ptr<Texture> texture) {
+        if (prefetch && texture) {
+            addPrefetchBytes(date, texture->getSourceSize());
+        }
+        auto state = error == Error::None ? FeedGameRecap::ThumbnailState::Loaded : FeedGameRecap::ThumbnailState::Error;
+        // The feed owns its thumbnails so they go when it does. If it has already gone, or a refresh has since
+        // changed the game's thumbnail, don't leave this one behind
+        bool owned = false;
+        bool found = false;
+        auto feed = weakFeed.lock();
+        if (feed) {
+            std::lock_guard<std::mutex> lock(feed->mutex_);
+            for (auto& current : feed->recaps_) {
+                if (current->park == recap->park && current->thumbnailUrl == recap->thumbnailUrl) {
+                    found = true;
+                    if (current->thumbnailReleased_) {
+                        // Released while we were loading, the next acquire loads it again
+                        current->setThumbnailState(FeedGameRecap::ThumbnailState::Unloaded);
+                        break;
+                    }
+                    // A refresh may have replaced the recap while we were loading
+                    if (handle && !feed->released_) {
+                        current->setThumbnail(handle);
+                        owned = true;
+                    }
+                    current->setThumbnailState(state);
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            recap->setThumbnailState(state);
+        }
+        if (!owned) {
+            textureService_->removeTexture(handle);
+        }
+    }, priority, verbose_ ? FeedService::getThumbnailKeyForRecap(date, recap->park) : std::string());
+}
+
+void FeedService::setThumbnailsOnDemand(bool onDemand) {
+    thumbnailsOnDemand_ = onDemand;
+}
+
+void FeedService::acquireThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority) {
+    std::unique_lock<std::mutex> lock(feed->mutex_);
+    if (feed->released_ || std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) == feed->recaps_.end()) {
+        return;
+    }
+    recap->thumbnailReleased_ = false;
+    lock.unlock();
+    loadThumbnail(feed, recap, priority, false);
+}
+
+void FeedService::releaseThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap) {
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    if (feed->released_ || std::find(feed->recaps_.begin(), feed->recaps_.end(), recap) == feed->recaps_.end()) {
+        return;
+    }
+    recap->thumbnailReleased_ = true;
+    // One still loading is dropped when it arrives
+    if (recap->getThumbnailState() != FeedGameRecap::ThumbnailState::Loading) {
+        removeThumbnail(recap);
+        recap->setThumbnailState(FeedGameRecap::ThumbnailState::Unloaded);
+    }
+}
 
+void FeedService::addPrefetchBytes(const std::string& date, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = prefetched_.find(date);
+    if (it != prefetched_.end()) {
+        it->second.bytes += bytes;
     }
 }
 
 std::shared_ptr<Feed> FeedService::getFeed(const std::string& date) {
+    return published_.find(date);
+}
+
+void FeedService::removeFeed(const std::string& date) {
+    std::unique_lock<std::mutex> lock(mutex_);
     auto it = feeds_.find(date);
     if (it != feeds_.end()) {
-        return it->second;
+        auto feed = it->second.feed;
+        lru_.erase(it->second.lru);
+        feeds_.erase(it);
+        published_.erase(date);
+        dates_->setCached(date, false);
+        lock.unlock();
+        releaseFeed(feed);
     }
-    return nullptr;
 }
 
-void FeedService::removeFeed(const std::string& date) {
+void FeedService::removeFeed(const std::shared_ptr<Feed>& feed) {
+    if (feed) {
+        removeFeed(feed->getDate());
+    }
+}
+
+void FeedService::setCacheBudget(size_t maxFeeds, size_t maxBytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    maxCachedFeeds_ = std::max<size_t>(maxFeeds, 1);
+    maxCacheBytes_ = maxBytes;
+    lock.unlock();
+    trimCache();
+}
+
+void FeedService::pinFeed(const std::string& date) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    pinnedDate_ = date;
     auto it = feeds_.find(date);
     if (it != feeds_.end()) {
-        auto feed = it->second;
-        
-        // It is up to us to dispose of the textures
-        std::lock_guard<std::mutex> lock(feed->mutex_);
-        auto numRecaps = feed->getNumRecaps();
-        for (decltype(numRecaps) i=0;i<numRecaps;++i) {
-            auto recap = feed->getRecapAtIndex(i);
-            // Key for headlines is date-index-headline
-            auto key = FeedService::getHeadlineKeyForRecap(date, i);
-            fontTextService_->removeString(key);
-            key = FeedService::getDescriptionKeyForRecap(date, i);
-            fontTextService_->removeString(key);
-            key = FeedService::getThumbnailKeyForRecap(date, i);
-            textureService_->removeTexture(key);
-        }
+        touchFeed(it->second);
+    }
+    lock.unlock();
+    // The previously pinned feed may have been the only thing keeping us over budget
+    trimCache();
+}
 
-        feed->strings_.clear();
-        feed->thumbnails_.clear();
+FeedService::CacheStats FeedService::getCacheStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CacheStats stats{};
+    stats.feeds = feeds_.size();
+    for (auto& it : feeds_) {
+        stats.bytes += getFeedBytes(it.second.feed);
     }
+    stats.evictions = evictions_;
+    return stats;
 }
 
-void FeedService::removeFeed(const std::shared_ptr<Feed>& feed) {
-    for (auto it : feeds_) {
-        if (it.second == feed) {
-            removeFeed(it.first);
-            return;
+void FeedService::touchFeed(CachedFeed& cached) {
+    lru_.splice(lru_.begin(), lru_, cached.lru);
+}
+
+size_t FeedService::getFeedBytes(const std::shared_ptr<Feed>& feed) {
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    size_t bytes = sizeof(Feed);
+    for (auto& recap : feed->recaps_) {
+        bytes += sizeof(FeedGameRecap) + recap->date.capacity() + recap->headline.capacity() + recap->description.capacity() + recap->thumbnailUrl.capacity();
+        for (auto& cut : recap->thumbnailCuts) {
+            bytes += sizeof(ThumbnailCut) + cut.url.capacity();
+        }
+        for (auto handle : { recap->headlineTex_, recap->descriptionTex_, recap->getThumbnail(), recap->getFocusThumbnail() }) {
+            auto tex = textureService_->getTexture(handle);
+            if (tex) {
+                bytes += tex->getWidth() * tex->getHeight() * kBytesPerPixel;
+            }
         }
     }
+    return bytes;
+}
+
+void FeedService::trimCache() {
+    std::vector<std::shared_ptr<Feed>> evicted;
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Thumbnails keep arriving after a feed is cached, so sizes are measured each time rather than tracked
+    size_t bytes = 0;
+    for (auto& it : feeds_) {
+        bytes += getFeedBytes(it.second.feed);
+    }
+    auto it = lru_.end();
+    while ((feeds_.size() > maxCachedFeeds_ || bytes > maxCacheBytes_) && it != lru_.begin()) {
+        --it;
+        // The most recently used feed was just fetched or moved to, and the pinned one is on screen
+        if (it == lru_.begin() || *it == pinnedDate_) {
+            continue;
+        }
+        auto cached = feeds_.find(*it);
+        bytes -= getFeedBytes(cached->second.feed);
+        evicted.push_back(cached->second.feed);
+        published_.erase(*it);
+        dates_->setCached(*it, false);
+        feeds_.erase(cached);
+        it = lru_.erase(it);
+    }
+    evictions_ += static_cast<uint32_t>(evicted.size());
+    lock.unlock();
+
+    for (auto& feed : evicted) {
+        Log(LogLevel::Info) << "Evicting feed " << feed->getDate();
+        releaseFeed(feed);
+    }
+}
+
+void FeedService::releaseFeed(const std::shared_ptr<Feed>& feed) {
+    // All in one go under the feed's lock so a late thumbnail can't slip in behind us
+    std::lock_guard<std::mutex> lock(feed->mutex_);
+    for (auto& recap : feed->recaps_) {
+        removeRecapStrings(recap);
+        removeThumbnail(recap);
+    }
+    feed->recaps_.clear();
+    feed->released_ = true;
 }
 
 std::string FeedService::getFeedUrl(const std::string& date) const {
@@ -196,3 +887,7 @@ std::string FeedService::getFeedUrl(const std::string& date) const {
     // We also assume date is the proper format
     return kBaseFeedUrl + date + kTrailingFeedQueryParam;
 }
+
+std::string FeedService::getFeedRangeUrl(const std::string& startDate, const std::string& endDate) const {
+    return kBaseRangeFeedUrl + startDate + kRangeFeedEndDateParam + endDate + kTrailingFeedQueryParam;
+}
@@ -15,54 +15,204 @@
 #include "textureService.hpp"
 #include "fontTextService.hpp"
 #include "feed.hpp"
+#include "feedSnapshot.hpp"
+#include "dateIndex.hpp"
+#include "rcuRegistry.h"
 
+#include <atomic>
 #include <memory>
 #include <functional>
+#include <list>
 #include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 class FeedService {
 public:
+    struct PrefetchStats {
+        uint32_t    feeds;          // Feeds fetched ahead of the user
+        uint32_t    hits;           // Prefetched feeds the user then moved to
+        uint64_t    bytes;          // Feed and warmed thumbnail bytes fetched ahead
+        uint64_t    wastedBytes;    // Bytes belonging to prefetched feeds the user never moved to
+        double      hitRatio;
+    };
+
+    struct RecapText {
+        std::shared_ptr<Texture>    headline;
+        std::shared_ptr<Texture>    description;
+    };
+
+    struct CacheStats {
+        size_t      feeds;
+        size_t      bytes;          // Estimate of recap data plus the decoded text and thumbnail textures
+        uint32_t    evictions;
+    };
+
     FeedService() = delete;
-    FeedService(const std::shared_ptr<ResourceFetcherService>& fetcher, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, int wrapLimit, bool verbose);
+    // defaultDate is clamped into dates
+    FeedService(const std::shared_ptr<ResourceFetcherService>& fetcher, const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<DateIndex>& dates, const std::string& defaultDate, int wrapLimit, bool verbose);
     ~FeedService();
 
+    // Recap textures are only reachable by handle, these name them in verbose debugging output
     static std::string getHeadlineKeyForRecap(const std::string& date, size_t recap);
     static std::string getDescriptionKeyForRecap(const std::string& date, size_t recap);
     static std::string getThumbnailKeyForRecap(const std::string& date, size_t recap);
 
-    // The plan right now is to support getting different feeds based on available dates from dates_
-    // We use this as our first date to fetch AND in case there isn't enough time for full implementation
-    // This is very much a curated experience
+    // scheme://host of the feed API, used for connection prewarming
+    static std::string getFeedHostUrl();
+
+    // Feeds can be fetched for any date in the index. The default date is the first one fetched
     std::string getDefaultDate() const;
     int32_t getDefaultDateIndex() const;
     size_t getNumDates() const;
     std::string getDateAtIndex(size_t index) const;
+    // Game counts and which dates are cached are kept up to date as feeds come and go
+    std::shared_ptr<DateIndex> getDateIndex() const { return dates_; }
     
+    // If the feed is already being fetched, for instance by a prefetch, the callback is added to that request.
+    // If the date is in the snapshot the callback gets that straight away, marked stale, and the feed is revalidated
+    // from the network behind it. Changes are patched into the feed in place. If the network fails the stale feed
+    // stays cached and is what anyone waiting on the date gets, along with the error
     void fetchFeed(const std::string& date, std::function<void(Error error, uint32_t status, std::shared_ptr<Feed>)> callback);
+
+    // Fetches every date from startDate to endDate inclusive, calling callback once per date. Cached dates are answered
+    // straight away, and dates already being fetched join those requests. The rest go out as one ranged request per run
+    // of consecutive dates, parsed in a single pass, and each date's callback fires as soon as its part is parsed.
+    // If the dates don't parse or endDate is before startDate, callback is called once with Error::NoResourceName
+    void fetchFeeds(const std::string& startDate, const std::string& endDate, std::function<void(Error error, uint32_t status, std::shared_ptr<Feed>)> callback, FetchPriority priority = FetchPriority::Normal);
+
+    // Every successfully parsed feed is stored to the snapshot, and dates missing from the cache are restored from it
+    void setSnapshot(const std::shared_ptr<FeedSnapshot>& snapshot);
+
+    // Refetches a cached feed. Only the recaps which changed are rebuilt, matched up by park, and the feed's
+    // version is bumped so whoever is showing it can patch itself. Nothing happens if the date isn't cached
+    void refreshFeed(const std::string& date);
+    // Refreshes the date if it hasn't been for the refresh interval (ms). An interval of 0 disables this
+    void setRefreshInterval(int64_t interval);
+    void refreshIfStale(const std::string& date);
+
+    // Fetches the feeds of the dates within the prefetch radius of dateIndex at prefetch priority, along with their first
+    // few thumbnails, so moving to a neighbouring date usually finds its feed ready. Neighbouring dates are fetched
+    // together with ranged requests. A radius of 0 disables prefetching
+    void setPrefetchRadius(uint32_t radius);
+    void prefetchAround(size_t dateIndex);
+    PrefetchStats getPrefetchStats();
     
+    // Wait-free, safe to call from the render thread while workers are caching feeds
     std::shared_ptr<Feed> getFeed(const std::string& date);
     
+    // Text is only rasterized for the games the carousel is close to showing, rather than for every game as the feed
+    // arrives. The feed owns the textures. Either may come back null if the feed or recap has since been replaced
+    RecapText acquireRecapText(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap);
+    void releaseRecapText(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap);
+
+    // Size of a focused thumbnail in output pixels, and the scale of the rest. Thumbnails are loaded with the smallest
+    // cut covering their unfocused size, so bytes and texture memory follow what's drawn. A width of 0, the default,
+    // loads each recap's thumbnailUrl
+    void setThumbnailSize(uint32_t width, uint32_t height, double unfocusedScale);
+    // Loads a cut covering the focused size if the unfocused one doesn't. It lands in the recap's focus thumbnail,
+    // which the feed owns until releaseFocusThumbnail. Does nothing while one is loading or loaded, so callers can
+    // call it again to retry a failed upgrade
+    void focusThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap);
+    void releaseFocusThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap);
+
+    // Off by default, where every thumbnail of a feed is loaded once it is fetched. When on, only the first few of a
+    // prefetched feed are loaded until acquired, so only what's near the screen is downloaded and resident. Released
+    // thumbnails go back to Unloaded
+    void setThumbnailsOnDemand(bool onDemand);
+    void acquireThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority);
+    void releaseThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap);
+
+    // Removing a feed releases its text textures, thumbnails and recaps. Anyone still holding the feed sees it empty
     void removeFeed(const std::string& date);
     void removeFeed(const std::shared_ptr<Feed>& feed);
+
+    // Least recently used feeds are evicted once either budget is exceeded. The pinned date, normally the one
+    // on screen, and the most recently used feed are never evicted. The default date starts out pinned
+    void setCacheBudget(size_t maxFeeds, size_t maxBytes);
+    void pinFeed(const std::string& date);
+    CacheStats getCacheStats();
     
 private:
+    struct PendingFetch {
+        bool    prefetched = false; // Issued by prefetchAround
+        bool    demanded = false;   // fetchFeed has since asked for it
+        std::vector<std::function<void(Error error, uint32_t status, std::shared_ptr<Feed>)>> callbacks;
+    };
+
+    struct CachedFeed {
+        std::shared_ptr<Feed>               feed;
+        std::list<std::string>::iterator    lru;
+        int64_t                             refreshedAt;    // Epoch ms
+    };
+
+    struct PrefetchRecord {
+        uint64_t    bytes = 0;
+        bool        hit = false;
+    };
+
     bool                                    verbose_;
     std::shared_ptr<ResourceFetcherService> fetcher_;
     std::shared_ptr<TextureService>         textureService_;
     std::shared_ptr<FontTextService>        fontTextService_;
+    std::shared_ptr<FeedSnapshot>           snapshot_;
     FontTextService::Font                   headlineFont_;
     FontTextService::Font                   descriptionFont_;
 
     int32_t                                 defaultDateIndex_;
     int                                     wrapLimit_;
+    uint32_t                                prefetchRadius_;
+    std::atomic<uint32_t>                   thumbnailWidth_;
+    std::atomic<uint32_t>                   thumbnailHeight_;
+    std::atomic<double>                     unfocusedScale_;
+    std::atomic<bool>                       thumbnailsOnDemand_;
     
-    std::vector<std::string>                dates_;
+    std::shared_ptr<DateIndex>              dates_;
 
     std::mutex                              mutex_;
-    std::unordered_map<std::string, std::shared_ptr<Feed>>   feeds_;
+    std::unordered_map<std::string, CachedFeed>              feeds_;
+    RcuRegistry<std::string, std::shared_ptr<Feed>>          published_;  // What's in feeds_, for getFeed. Written under mutex_
+    std::list<std::string>                                   lru_;   // Most recently used first
+    std::string                                              pinnedDate_;
+    size_t                                                   maxCachedFeeds_;
+    size_t                                                   maxCacheBytes_;
+    uint32_t                                                 evictions_;
+    int64_t                                                  refreshInterval_;
+    std::unordered_map<std::string, PendingFetch>            pending_;
+    std::unordered_map<std::string, PrefetchRecord>          prefetched_;
     
     std::string getFeedUrl(const std::string& date) const;
+    std::string getFeedRangeUrl(const std::string& startDate, const std::string& endDate) const;
+    // Marks the date as being prefetched, returns false if it is already cached or on its way
+    bool startPrefetch(const std::string& date);
+    // Dates are in order and already in pending_. Single dates use the plain request
+    void fetchRanges(const std::vector<std::string>& dates, FetchPriority priority);
+    void onFeedFetched(const std::string& date, Error error, uint32_t status, std::vector<uint8_t>& buffer);
+    // If the indexed parser rejects the response, the dates it didn't get to are fetched again one at a time, which
+    // gives them onFeedFetched's SAX fallback
+    void onFeedsFetched(const std::vector<std::string>& dates, FetchPriority priority, Error error, uint32_t status, std::vector<uint8_t>& buffer);
+    // Caches or patches in parsed, if any, and answers everyone waiting on the date
+    void completeFetch(const std::string& date, Error error, uint32_t status, const std::shared_ptr<Feed>& parsed, size_t bytes);
+    // Caches the date's snapshot copy, marked stale. Null if the snapshot doesn't have the date
+    std::shared_ptr<Feed> restoreFeed(const std::string& date);
+    // Inserts the feed as most recently used, replacing and releasing anything cached for the date
+    void cacheFeed(const std::string& date, const std::shared_ptr<Feed>& feed, int64_t refreshedAt);
+    // Brings feed in line with parsed, returns false if feed has since been released
+    bool patchFeed(const std::shared_ptr<Feed>& feed, const std::shared_ptr<Feed>& parsed, bool& changed);
+    // Callers hold the feed's mutex
+    void removeRecapStrings(const std::shared_ptr<FeedGameRecap>& recap);
+    void removeThumbnail(const std::shared_ptr<FeedGameRecap>& recap);
+    void removeFocusThumbnail(const std::shared_ptr<FeedGameRecap>& recap);
+    // What loadThumbnails and focusThumbnail ask for
+    const std::string& getThumbnailUrl(const std::shared_ptr<FeedGameRecap>& recap, bool focused) const;
+    void loadThumbnails(const std::shared_ptr<Feed>& feed, bool prefetch);
+    void loadThumbnail(const std::shared_ptr<Feed>& feed, const std::shared_ptr<FeedGameRecap>& recap, FetchPriority priority, bool prefetch);
+    void addPrefetchBytes(const std::string& date, uint64_t bytes);
+    // Callers hold mutex_
+    void touchFeed(CachedFeed& cached);
+    size_t getFeedBytes(const std::shared_ptr<Feed>& feed);
+    void trimCache();
+    void releaseFeed(const std::shared_ptr<Feed>& feed);
 };
 
 #endif /* feedService_hpp */
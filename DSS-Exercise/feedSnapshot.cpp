@@ -0,0 +1,342 @@
+//
+//  feedSnapshot.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/14/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "feedSnapshot.hpp"
+#include "epoch.h"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char kFeedSnapshotMagic[4] = { 'D', 'S', 'S', 'F' };
+static const uint32_t kFeedSnapshotVersion = 2;
+// How long the writer waits after a store for others to join it
+static const std::chrono::milliseconds kWriteDelay(2000);
+
+template<typename T>
+static void appendValue(std::vector<uint8_t>& buffer, T value) {
+    auto bytes = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+static void appendString(std::vector<uint8_t>& buffer, const std::string& str) {
+    appendValue<uint32_t>(buffer, static_cast<uint32_t>(str.size()));
+    buffer.insert(buffer.end(), str.begin(), str.end());
+}
+
+template<typename T>
+static void writeValue(FILE *file, T value) {
+    fwrite(&value, sizeof(T), 1, file);
+}
+
+static void writeString(FILE *file, const std::string& str) {
+    writeValue<uint32_t>(file, static_cast<uint32_t>(str.size()));
+    fwrite(str.data(), 1, str.size(), file);
+}
+
+// Bounds checked reads out of the mapping. Once a read fails every following read fails too
+class SnapshotReader {
+public:
+    SnapshotReader(const uint8_t *data, size_t size) : pos_(data), end_(data + size), failed_(false) {}
+
+    template<typename T>
+    bool readValue(T& value) {
+        if (failed_ || static_cast<size_t>(end_ - pos_) < sizeof(T)) {
+            failed_ = true;
+            return false;
+        }
+        memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& str) {
+        uint32_t size = 0;
+        if (!readValue(size) || static_cast<size_t>(end_ - pos_) < size) {
+            failed_ = true;
+            return false;
+        }
+        str.assign(reinterpret_cast<const char *>(pos_), size);
+        pos_ += size;
+        return true;
+    }
+
+    bool readMagic() {
+        if (failed_ || static_cast<size_t>(end_ - pos_) < sizeof(kFeedSnapshotMagic) || memcmp(pos_, kFeedSnapshotMagic, sizeof(kFeedSnapshotMagic))) {
+            failed_ = true;
+            return false;
+        }
+        pos_ += sizeof(kFeedSnapshotMagic);
+        return true;
+    }
+
+private:
+    const uint8_t   *pos_;
+    const uint8_t   *end_;
+    bool            failed_;
+};
+
+FeedSnapshot::FeedSnapshot(const std::string& path, size_t maxDates, size_t maxBytes) : path_(path), maxDates_(std::max<size_t>(maxDates, 1)), maxBytes_(maxBytes), mapping_(nullptr), mappingSize_(0), dirty_(false), quit_(false) {
+    writer_ = std::thread([this]() {
+        runWriter();
+    });
+}
+
+FeedSnapshot::~FeedSnapshot() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    quit_ = true;
+    lock.unlock();
+    cond_.notify_one();
+    writer_.join();
+
+    // Blocks loaded from the file point into the mapping, so it has to outlive them
+    blocks_.clear();
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+    }
+}
+
+bool FeedSnapshot::load() {
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    void *mapping = MAP_FAILED;
+    if (!fstat(fd, &info) && info.st_size > 0) {
+        mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps the file alive, and later writes rename over it rather than modify it
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    auto data = static_cast<const uint8_t *>(mapping);
+    auto size = static_cast<size_t>(info.st_size);
+    SnapshotReader reader(data, size);
+    uint32_t version = 0;
+    uint32_t count = 0;
+    bool success = reader.readMagic() && reader.readValue(version) && version == kFeedSnapshotVersion && reader.readValue(count);
+
+    std::unordered_map<std::string, Block> blocks;
+    for (uint32_t i=0;success && i<count;++i) {
+        std::string date;
+        Block block{};
+        uint64_t offset = 0;
+        uint64_t blockSize = 0;
+        success = reader.readString(date) && reader.readValue(block.savedTime) && reader.readValue(offset) && reader.readValue(blockSize);
+        if (success && (offset > size || blockSize > size - offset)) {
+            success = false;
+        }
+        if (success) {
+            block.data = data + offset;
+            block.size = static_cast<size_t>(blockSize);
+            blocks[date] = block;
+        }
+    }
+
+    if (!success) {
+        Log(LogLevel::Warning) << "Ignoring damaged or out of date feed snapshot " << path_;
+        munmap(mapping, size);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mapping_) {
+        // Only the first load is expected, anything else would leave blocks pointing at the old mapping
+        munmap(mapping, size);
+        return false;
+    }
+    mapping_ = mapping;
+    mappingSize_ = size;
+    for (auto& it : blocks) {
+        // Anything stored before the load is newer
+        blocks_.emplace(it.first, it.second);
+    }
+    // A file written with larger limits is rewritten within ours
+    auto numBlocks = blocks_.size();
+    trim();
+    if (blocks_.size() != numBlocks) {
+        dirty_ = true;
+        cond_.notify_one();
+    }
+    return true;
+}
+
+bool FeedSnapshot::hasFeed(const std::string& date) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return blocks_.find(date) != blocks_.end();
+}
+
+std::shared_ptr<Feed> FeedSnapshot::getFeed(const std::string& date) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = blocks_.find(date);
+    if (it == blocks_.end()) {
+        return nullptr;
+    }
+    // Copy so a store for the same date can't pull owned out from under us
+    Block block = it->second;
+    lock.unlock();
+
+    SnapshotReader reader(block.data, block.size);
+    uint32_t count = 0;
+    if (!reader.readValue(count)) {
+        return nullptr;
+    }
+    std::vector<std::shared_ptr<FeedGameRecap>> recaps;
+    for (uint32_t i=0;i<count;++i) {
+        uint32_t park = 0;
+        std::string headline;
+        std::string description;
+        std::string thumbnailUrl;
+        if (!reader.readValue(park) || !reader.readString(headline) || !reader.readString(description) || !reader.readString(thumbnailUrl)) {
+            Log(LogLevel::Warning) << "Feed snapshot block for " << date << " is damaged";
+            return nullptr;
+        }
+        // Cuts are read one at a time, a damaged count runs out of block rather than allocating it all up front
+        uint32_t numCuts = 0;
+        std::vector<ThumbnailCut> cuts;
+        bool damaged = !reader.readValue(numCuts);
+        for (uint32_t j=0;!damaged && j<numCuts;++j) {
+            ThumbnailCut cut;
+            damaged = !reader.readValue(cut.width) || !reader.readValue(cut.height) || !reader.readString(cut.url);
+            cuts.push_back(std::move(cut));
+        }
+        if (damaged) {
+            Log(LogLevel::Warning) << "Feed snapshot block for " << date << " is damaged";
+            return nullptr;
+        }
+        recaps.push_back(std::make_shared<FeedGameRecap>(date, park, headline, description, thumbnailUrl, std::move(cuts)));
+    }
+    return std::make_shared<Feed>(date, std::move(recaps));
+}
+
+int64_t FeedSnapshot::getSavedTime(const std::string& date) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.find(date);
+    return it != blocks_.end() ? it->second.savedTime : 0;
+}
+
+void FeedSnapshot::store(const std::shared_ptr<Feed>& feed) {
+    auto encoded = std::make_shared<std::vector<uint8_t>>();
+    auto numRecaps = feed->getNumRecaps();
+    appendValue<uint32_t>(*encoded, static_cast<uint32_t>(numRecaps));
+    for (decltype(numRecaps) i=0;i<numRecaps;++i) {
+        auto recap = feed->getRecapAtIndex(i);
+        appendValue<uint32_t>(*encoded, recap->park);
+        appendString(*encoded, recap->headline);
+        appendString(*encoded, recap->description);
+        appendString(*encoded, recap->thumbnailUrl);
+        appendValue<uint32_t>(*encoded, static_cast<uint32_t>(recap->thumbnailCuts.size()));
+        for (auto& cut : recap->thumbnailCuts) {
+            appendValue<uint32_t>(*encoded, cut.width);
+            appendValue<uint32_t>(*encoded, cut.height);
+            appendString(*encoded, cut.url);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    blocks_[feed->getDate()] = Block{EpochTime::timeInMilliSec(), encoded->data(), encoded->size(), encoded};
+    trim();
+    dirty_ = true;
+    lock.unlock();
+    cond_.notify_one();
+}
+
+void FeedSnapshot::runWriter() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cond_.wait(lock, [this]() {
+            return dirty_ || quit_;
+        });
+        if (dirty_) {
+            // Let a burst of stores land first. Quitting writes straight away
+            cond_.wait_for(lock, kWriteDelay, [this]() {
+                return quit_;
+            });
+            dirty_ = false;
+            std::vector<std::pair<std::string, Block>> blocks(blocks_.begin(), blocks_.end());
+            lock.unlock();
+            if (!write(blocks)) {
+                Log(LogLevel::Warning) << "Could not write feed snapshot " << path_;
+            }
+            lock.lock();
+        } else if (quit_) {
+            break;
+        }
+    }
+}
+
+void FeedSnapshot::trim() {
+    size_t bytes = 0;
+    for (auto& it : blocks_) {
+        bytes += it.second.size;
+    }
+    if (blocks_.size() <= maxDates_ && bytes <= maxBytes_) {
+        return;
+    }
+    std::vector<std::pair<int64_t, std::string>> byAge;
+    byAge.reserve(blocks_.size());
+    for (auto& it : blocks_) {
+        byAge.emplace_back(it.second.savedTime, it.first);
+    }
+    std::sort(byAge.begin(), byAge.end());
+    // The newest date is always kept, even on its own over the byte budget
+    for (size_t i=0;i+1<byAge.size() && (blocks_.size() > maxDates_ || bytes > maxBytes_);++i) {
+        auto it = blocks_.find(byAge[i].second);
+        bytes -= it->second.size;
+        blocks_.erase(it);
+    }
+}
+
+bool FeedSnapshot::write(const std::vector<std::pair<std::string, Block>>& blocks) {
+    // Ignore the result, most of the time it will already exist
+    auto slash = path_.rfind('/');
+    if (slash != std::string::npos) {
+        mkdir(path_.substr(0, slash).c_str(), 0755);
+    }
+
+    auto tmpPath = path_ + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    uint64_t offset = sizeof(kFeedSnapshotMagic) + sizeof(uint32_t) * 2;
+    for (auto& it : blocks) {
+        offset += sizeof(uint32_t) + it.first.size() + sizeof(int64_t) + sizeof(uint64_t) * 2;
+    }
+    fwrite(kFeedSnapshotMagic, 1, sizeof(kFeedSnapshotMagic), file);
+    writeValue<uint32_t>(file, kFeedSnapshotVersion);
+    writeValue<uint32_t>(file, static_cast<uint32_t>(blocks.size()));
+    for (auto& it : blocks) {
+        writeString(file, it.first);
+        writeValue<int64_t>(file, it.second.savedTime);
+        writeValue<uint64_t>(file, offset);
+        writeValue<uint64_t>(file, it.second.size);
+        offset += it.second.size;
+    }
+    for (auto& it : blocks) {
+        fwrite(it.second.data, 1, it.second.size, file);
+    }
+
+    // Readers, including the mapping we may have open, only ever see a complete file
+    bool success = !ferror(file);
+    success = !fclose(file) && success;
+    if (!success || rename(tmpPath.c_str(), path_.c_str())) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+//
+//  feedSnapshot.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/14/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef feedSnapshot_hpp
+#define feedSnapshot_hpp
+
+#include <stdio.h>
+#include "feed.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+
+// Parsed feeds persisted between runs, so the carousel has something to show before the network answers. Thread safe
+//
+// File format (native endianness):
+//   "DSSF" magic, uint32 version, uint32 date count
+//   Index, per date: string date, int64 saved time (epoch ms), uint64 offset of its block, uint64 size of its block
+//   Block: uint32 recap count, then per recap: uint32 park, string headline, string description, string thumbnail url,
+//          uint32 cut count, then per cut: uint32 width, uint32 height, string url
+//   Strings are uint32 length prefixed
+//
+// The file is mapped rather than read, and a date's block is only decoded when that date is asked for.
+// Only the most recently stored dates are kept, up to maxDates and maxBytes of blocks, so the file and the cost of
+// rewriting it stay bounded however many dates are browsed
+class FeedSnapshot {
+public:
+    static constexpr size_t kDefaultMaxDates = 60;
+    static constexpr size_t kDefaultMaxBytes = 4 * 1024 * 1024;
+
+    FeedSnapshot() = delete;
+    FeedSnapshot(const std::string& path, size_t maxDates = kDefaultMaxDates, size_t maxBytes = kDefaultMaxBytes);
+    // Waits for any pending write
+    ~FeedSnapshot();
+
+    bool load();
+
+    bool hasFeed(const std::string& date);
+    // Returns nullptr if the date isn't in the snapshot or its block is damaged
+    std::shared_ptr<Feed> getFeed(const std::string& date);
+    // Epoch ms the date was last stored, 0 if it isn't in the snapshot
+    int64_t getSavedTime(const std::string& date);
+
+    // The feed is encoded on the calling thread and the file is rewritten on a background thread. Writes wait a
+    // moment after the first store so a burst of them, such as a ranged fetch, is written once. Stores made while
+    // a write is under way are picked up by the next one
+    void store(const std::shared_ptr<Feed>& feed);
+
+private:
+    struct Block {
+        int64_t                                     savedTime;
+        const uint8_t                               *data;  // Into the mapping or into owned
+        size_t                                      size;
+        std::shared_ptr<const std::vector<uint8_t>> owned;  // Blocks stored this run
+    };
+
+    std::string                             path_;
+    size_t                                  maxDates_;
+    size_t                                  maxBytes_;
+    void                                    *mapping_;
+    size_t                                  mappingSize_;
+
+    std::mutex                              mutex_;
+    std::condition_variable                 cond_;
+    bool                                    dirty_;
+    bool                                    quit_;
+    std::unordered_map<std::string, Block>  blocks_;
+    std::thread                             writer_;
+
+    // Drops the least recently stored dates until within maxDates_ and maxBytes_. Called with mutex_ held
+    void trim();
+    void runWriter();
+    bool write(const std::vector<std::pair<std::string, Block>>& blocks);
+};
+
+#endif /* feedSnapshot_hpp */
@@ -0,0 +1,125 @@
+//
+//  fetchTrace.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/8/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "fetchTrace.hpp"
+#include "json.hpp"
+
+#include <fstream>
+#include <map>
+
+FetchTraceLog::FetchTraceLog(size_t capacity) : capacity_(capacity ? capacity : 1), next_(0) {
+    entries_.reserve(capacity_);
+}
+
+void FetchTraceLog::add(const FetchTiming& timing) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.size() < capacity_) {
+        entries_.push_back(timing);
+    } else {
+        entries_[next_] = timing;
+    }
+    next_ = (next_ + 1) % capacity_;
+}
+
+std::vector<FetchTiming> FetchTraceLog::getEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<FetchTiming> entries;
+    entries.reserve(entries_.size());
+    if (entries_.size() < capacity_) {
+        entries = entries_;
+    } else {
+        // Full, so next_ is the oldest entry
+        entries.insert(entries.end(), entries_.begin() + next_, entries_.end());
+        entries.insert(entries.end(), entries_.begin(), entries_.begin() + next_);
+    }
+    return entries;
+}
+
+std::vector<FetchHostSummary> FetchTraceLog::getHostSummaries() {
+    // std::map so hosts come out in a stable order
+    std::map<std::string, FetchHostSummary> hosts;
+    for (auto& entry : getEntries()) {
+        auto it = hosts.find(entry.host);
+        if (it == hosts.end()) {
+            // Value initialized, so the totals start at zero
+            it = hosts.emplace(entry.host, FetchHostSummary()).first;
+            it->second.host = entry.host;
+        }
+        auto& summary = it->second;
+        summary.count++;
+        if (entry.error != Error::None) {
+            summary.failures++;
+        }
+        summary.bytes += entry.bytes;
+        summary.avgQueueWait += entry.queueWait;
+        summary.avgNameLookup += entry.nameLookup;
+        summary.avgConnect += entry.connect;
+        summary.avgAppConnect += entry.appConnect;
+        summary.avgStartTransfer += entry.startTransfer;
+        summary.avgTotal += entry.total;
+        if (entry.total > summary.maxTotal) {
+            summary.maxTotal = entry.total;
+        }
+        summary.retries += entry.retries;
+    }
+
+    std::vector<FetchHostSummary> summaries;
+    for (auto& it : hosts) {
+        auto summary = it.second;
+        auto count = static_cast<double>(summary.count);
+        summary.avgQueueWait /= count;
+        summary.avgNameLookup /= count;
+        summary.avgConnect /= count;
+        summary.avgAppConnect /= count;
+        summary.avgStartTransfer /= count;
+        summary.avgTotal /= count;
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
+
+bool FetchTraceLog::exportJsonl(const std::string& path) {
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+    for (auto& entry : getEntries()) {
+        rapidjson::StringBuffer buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+        writer.StartObject();
+        writer.Key("url");
+        writer.String(entry.url.c_str(), static_cast<rapidjson::SizeType>(entry.url.size()));
+        writer.Key("host");
+        writer.String(entry.host.c_str(), static_cast<rapidjson::SizeType>(entry.host.size()));
+        writer.Key("error");
+        writer.Uint(static_cast<uint32_t>(entry.error));
+        writer.Key("status");
+        writer.Uint(entry.status);
+        writer.Key("start");
+        writer.Int64(entry.startTime);
+        writer.Key("queueWait");
+        writer.Double(entry.queueWait);
+        writer.Key("nameLookup");
+        writer.Double(entry.nameLookup);
+        writer.Key("connect");
+        writer.Double(entry.connect);
+        writer.Key("appConnect");
+        writer.Double(entry.appConnect);
+        writer.Key("startTransfer");
+        writer.Double(entry.startTransfer);
+        writer.Key("total");
+        writer.Double(entry.total);
+        writer.Key("bytes");
+        writer.Uint64(entry.bytes);
+        writer.Key("retries");
+        writer.Int(entry.retries);
+        writer.EndObject();
+        out << buffer.GetString() << "\n";
+    }
+    return static_cast<bool>(out);
+}
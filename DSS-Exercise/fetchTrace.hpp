@@ -0,0 +1,76 @@
+//
+//  fetchTrace.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/8/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef fetchTrace_hpp
+#define fetchTrace_hpp
+
+#include <stdio.h>
+#include "errors.hpp"
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+// Timing for a single request. Times are in seconds and follow libcurl semantics, ie. they are
+// cumulative from the start of the transfer (connect includes nameLookup, etc)
+struct FetchTiming {
+    std::string url;
+    std::string host;
+    Error       error;
+    uint32_t    status;
+    int64_t     startTime;      // Epoch time in milliseconds
+    double      queueWait;      // Time spent in the worker pool queue
+    double      nameLookup;
+    double      connect;
+    double      appConnect;     // TLS handshake done, 0 for http
+    double      startTransfer;  // First byte received
+    double      total;
+    uint64_t    bytes;
+    int32_t     retries;
+
+    FetchTiming() : error(Error::None), status(0), startTime(0), queueWait(0), nameLookup(0), connect(0), appConnect(0), startTransfer(0), total(0), bytes(0), retries(0) {}
+};
+
+struct FetchHostSummary {
+    std::string host;
+    size_t      count;
+    size_t      failures;
+    uint64_t    bytes;
+    double      avgQueueWait;
+    double      avgNameLookup;
+    double      avgConnect;
+    double      avgAppConnect;
+    double      avgStartTransfer;
+    double      avgTotal;
+    double      maxTotal;
+    int32_t     retries;
+};
+
+// Bounded ring of the most recent request timings. Thread safe, workers add and anyone can read
+class FetchTraceLog {
+public:
+    FetchTraceLog() = delete;
+    FetchTraceLog(size_t capacity);
+
+    void add(const FetchTiming& timing);
+
+    // Oldest to newest
+    std::vector<FetchTiming> getEntries();
+    std::vector<FetchHostSummary> getHostSummaries();
+
+    // Writes one JSON object per line. Returns false if the file could not be written
+    bool exportJsonl(const std::string& path);
+
+private:
+    std::mutex                  mutex_;
+    size_t                      capacity_;
+    size_t                      next_;
+    std::vector<FetchTiming>    entries_;
+};
+
+#endif /* fetchTrace_hpp */
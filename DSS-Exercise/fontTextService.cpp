@@ -34,15 +34,14 @@ FontTextService::FontTextService(const std::shared_ptr<TextureService>& textureS
 }
 
 FontTextService::~FontTextService() {
-    std::lock_guard<std::mutex> lock(mutex_);
     for (auto font : fonts_) {
         TTF_CloseFont(font);
     }
     fonts_.clear();
     
-    for (auto it : strings_) {
-        textureService_->removeTexture(it.first);
-    }
+    strings_.forEach([this](const std::string& name, TextureHandle handle) {
+        textureService_->removeTexture(name);
+    });
     strings_.clear();
     
     TTF_Quit();
@@ -52,42 +51,50 @@ FontTextService::~FontTextService() {
 
 
 std::shared_ptr<Texture> FontTextService::getString(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = strings_.find(name);
-    if (it != strings_.end()) {
-        return it->second;
+    return textureService_->getTexture(strings_.find(name));
+}
+
+std::shared_ptr<Texture> FontTextService::addString(Font font, const std::string& name, const std::string& str, const Color& color, uint32_t wrapLength) {
+    auto existing = getString(name);
+    if (existing) {
+        return existing;
+    }
+    auto surface = renderString(font, str, color, wrapLength);
+    if (surface) {
+        // Surface will be destroyed for us
+        auto texture = textureService_->createTexture(name, surface, true);
+        if (texture) {
+            strings_.insert(name, textureService_->findTexture(name));
+        }
+        return texture;
     }
     return nullptr;
 }
 
-std::shared_ptr<Texture> FontTextService::addString(Font font, const std::string& name, const std::string& str, const Color& color, uint32_t wrapLength) {
+TextureHandle FontTextService::addString(Font font, const std::string& str, const Color& color, uint32_t wrapLength, const std::string& name) {
+    // Surface will be destroyed for us
+    return textureService_->createTexture(renderString(font, str, color, wrapLength), true, name);
+}
+
+void FontTextService::removeString(const std::string& name) {
+    if (strings_.erase(name)) {
+        textureService_->removeTexture(name);
+    }
+}
+
+void FontTextService::removeString(TextureHandle handle) {
+    textureService_->removeTexture(handle);
+}
+
+SDL_Surface *FontTextService::renderString(Font font, const std::string& str, const Color& color, uint32_t wrapLength) {
     SDL_Color sdlColor = { color.r, color.g, color.b, color.a };
     if (static_cast<uint32_t>(font) < fonts_.size()) {
         auto ttfFont = fonts_[static_cast<uint32_t>(font)];
-        SDL_Surface* surface;
         if (!wrapLength) {
-            surface = TTF_RenderUTF8_Blended(ttfFont, str.c_str(), sdlColor);
+            return TTF_RenderUTF8_Blended(ttfFont, str.c_str(), sdlColor);
         } else {
-            surface = TTF_RenderText_Blended_Wrapped(ttfFont, str.c_str(), sdlColor, wrapLength);
-        }
-        if (surface) {
-            // Surface will be destroyed for us
-            auto texture = textureService_->createTexture(name, surface, true);
-            if (texture) {
-                std::lock_guard<std::mutex> lock(mutex_);
-                strings_[name] = texture;
-            }
-            return texture;
+            return TTF_RenderText_Blended_Wrapped(ttfFont, str.c_str(), sdlColor, wrapLength);
         }
     }
     return nullptr;
 }
-
-void FontTextService::removeString(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = strings_.find(name);
-    if (it != strings_.end()) {
-        strings_.erase(name);
-        textureService_->removeTexture(name);
-    }
-}
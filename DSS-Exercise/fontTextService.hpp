@@ -13,6 +13,7 @@
 #include <SDL2/SDL_ttf.h>
 #include "types.h"
 #include "textureService.hpp"
+#include "rcuRegistry.h"
 
 #include <memory>
 #include <vector>
@@ -26,9 +27,13 @@ public:
     FontTextService(const std::shared_ptr<TextureService>& textureService, bool verbose);
     ~FontTextService();
     
+    // Named. Wait-free, like TextureService::getTexture
     std::shared_ptr<Texture> getString(const std::string& name);
     std::shared_ptr<Texture> addString(Font font, const std::string& name, const std::string& str, const Color& color, uint32_t wrapLength = 0);
     void removeString(const std::string& name);
+    // Anonymous, found through TextureService::getTexture(handle). name is only for debugging
+    TextureHandle addString(Font font, const std::string& str, const Color& color, uint32_t wrapLength = 0, const std::string& name = std::string());
+    void removeString(TextureHandle handle);
 
 private:
     bool                            verbose_;
@@ -41,8 +46,9 @@ private:
     // And the render them on the fly, perhaps even utilizing VBO/IBO
     // In this case, I've separated out and tracked the textures for strings here, as a means of indicating
     // The special nature of this as well as a workable "abstraction" for handling text based on the limitations of the rendering system
-    std::mutex                                                  mutex_;
-    std::unordered_map<std::string, std::shared_ptr<Texture>>   strings_;
+    RcuRegistry<std::string, TextureHandle>                     strings_;
+
+    SDL_Surface *renderString(Font font, const std::string& str, const Color& color, uint32_t wrapLength);
 };
 
 #endif /* fontTextService_hpp */
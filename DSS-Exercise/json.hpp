@@ -29,9 +29,39 @@ struct RapidJsonException : public std::exception {
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
 
+#include <cstdint>
 #include <string>
 #include <tuple>
 
+enum class JsonError : uint32_t {
+    None = 0,
+    MissingField = 1,
+    WrongType = 2,
+    InvalidValue = 3
+};
+
+// Result of unmarshalling. field is the name of the member at fault, if any, and is always a static string
+struct JsonStatus {
+    JsonError   error = JsonError::None;
+    const char  *field = nullptr;
+
+    explicit operator bool() const { return error == JsonError::None; }
+};
+
+inline const char *getJsonErrorString(JsonError error) {
+    switch (error) {
+        case JsonError::None:
+            return "none";
+        case JsonError::MissingField:
+            return "missing field";
+        case JsonError::WrongType:
+            return "wrong type";
+        case JsonError::InvalidValue:
+            return "invalid value";
+    }
+    return "unknown";
+}
+
 struct JsonSerializer {
     virtual ~JsonSerializer() {}
     
@@ -39,9 +69,7 @@ struct JsonSerializer {
     // what the state of the object will be (ie. it should be considered "corrupt").
     // If the state is important, then use a new object to run this on
     // or make a copy of the object and then unmarshall
-    virtual bool fromJson(const rapidjson::Value& json) =0;
-    
-    // Error handling variants
+    virtual JsonStatus fromJson(const rapidjson::Value& json) =0;
 };
 
 #endif /* json_hpp */
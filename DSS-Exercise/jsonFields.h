@@ -0,0 +1,226 @@
+//
+//  jsonFields.h
+//
+//  Created by Benjamin Lee on 6/20/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef jsonFields_h
+#define jsonFields_h
+
+#include <stdio.h>
+#include "json.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// FNV-1a. constexpr so field names can be hashed at compile time
+constexpr uint32_t jsonKeyHash(const char *str, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i=0;i<length;++i) {
+        hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+    }
+    return hash;
+}
+
+constexpr size_t jsonKeyLength(const char *str) {
+    size_t length = 0;
+    while (str[length]) {
+        ++length;
+    }
+    return length;
+}
+
+// One member of a JSON object, how to read it into T and whether the object is invalid without it
+template<typename T>
+struct JsonField {
+    using Reader = JsonStatus (*)(T& object, const rapidjson::Value& value);
+
+    const char  *name = nullptr;
+    size_t      length = 0;
+    uint32_t    hash = 0;
+    Reader      read = nullptr;
+    bool        required = true;
+
+    constexpr JsonField() {}
+    constexpr JsonField(const char *name, Reader read, bool required = true) : name(name), length(jsonKeyLength(name)), hash(jsonKeyHash(name, jsonKeyLength(name))), read(read), required(required) {}
+};
+
+// Readers for the common member types. Types are checked before anything is read, so RAPIDJSON_ASSERT never fires
+inline JsonStatus readJsonValue(std::string& out, const rapidjson::Value& value) {
+    if (!value.IsString()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    out.assign(value.GetString(), value.GetStringLength());
+    return JsonStatus();
+}
+
+inline JsonStatus readJsonValue(uint32_t& out, const rapidjson::Value& value) {
+    if (!value.IsUint()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    out = value.GetUint();
+    return JsonStatus();
+}
+
+inline JsonStatus readJsonValue(JsonSerializer& out, const rapidjson::Value& value) {
+    if (!value.IsObject()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    return out.fromJson(value);
+}
+
+// Every element has to be valid
+template<typename E>
+JsonStatus readJsonValue(std::vector<E>& out, const rapidjson::Value& value) {
+    if (!value.IsArray()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    out.clear();
+    out.reserve(value.Size());
+    for (auto it=value.Begin();it!=value.End();++it) {
+        E element;
+        auto status = readJsonValue(element, *it);
+        if (!status) {
+            return status;
+        }
+        out.push_back(std::move(element));
+    }
+    return JsonStatus();
+}
+
+// Invalid elements are left out
+template<typename E>
+JsonStatus readJsonValueSkippingInvalid(std::vector<E>& out, const rapidjson::Value& value) {
+    if (!value.IsArray()) {
+        return JsonStatus{JsonError::WrongType};
+    }
+    out.clear();
+    out.reserve(value.Size());
+    for (auto it=value.Begin();it!=value.End();++it) {
+        E element;
+        if (readJsonValue(element, *it)) {
+            out.push_back(std::move(element));
+        }
+    }
+    return JsonStatus();
+}
+
+template<typename M>
+struct JsonMemberTraits;
+
+template<typename C, typename V>
+struct JsonMemberTraits<V C::*> {
+    using Class = C;
+};
+
+template<auto Member>
+JsonStatus readJsonMember(typename JsonMemberTraits<decltype(Member)>::Class& object, const rapidjson::Value& value) {
+    return readJsonValue(object.*Member, value);
+}
+
+template<auto Member>
+JsonStatus readJsonMemberSkippingInvalid(typename JsonMemberTraits<decltype(Member)>::Class& object, const rapidjson::Value& value) {
+    return readJsonValueSkippingInvalid(object.*Member, value);
+}
+
+// eg. jsonField<&GameRecapCut::width>("width")
+template<auto Member>
+constexpr JsonField<typename JsonMemberTraits<decltype(Member)>::Class> jsonField(const char *name, bool required = true) {
+    return JsonField<typename JsonMemberTraits<decltype(Member)>::Class>(name, &readJsonMember<Member>, required);
+}
+
+// The fields of an object, declared once per struct. Reading makes a single pass over the object's members.
+// Each member's key is hashed and looked up in a perfect hash table built at compile time: the table size and
+// shift are searched for until every field lands in its own slot, so a lookup is one probe and one key compare.
+// Unknown members are skipped. Declaring a set of fields that can't be perfectly hashed fails to compile
+template<typename T, size_t N>
+class JsonFields {
+public:
+    static constexpr size_t kMaxSlots = 64;
+    static_assert(N > 0 && N <= 32, "Required fields are tracked in a 32 bit mask");
+
+    constexpr JsonFields(const JsonField<T> (&fields)[N]) : fields_(), slots_(), shift_(0), mask_(0) {
+        for (size_t i=0;i<N;++i) {
+            fields_[i] = fields[i];
+        }
+        size_t size = 1;
+        while (size < N) {
+            size <<= 1;
+        }
+        for (;size<=kMaxSlots;size<<=1) {
+            for (uint32_t shift=0;shift<=24;++shift) {
+                if (isPerfect(shift, static_cast<uint32_t>(size - 1))) {
+                    shift_ = shift;
+                    mask_ = static_cast<uint32_t>(size - 1);
+                    for (size_t i=0;i<N;++i) {
+                        slots_[getSlot(fields_[i].hash)] = static_cast<uint8_t>(i + 1);
+                    }
+                    return;
+                }
+            }
+        }
+        // Only reachable at compile time, where it is an error
+        throw std::logic_error("No perfect hash for these fields");
+    }
+
+    JsonStatus read(T& object, const rapidjson::Value& json) const {
+        if (!json.IsObject()) {
+            return JsonStatus{JsonError::WrongType};
+        }
+        uint32_t seen = 0;
+        for (auto it=json.MemberBegin();it!=json.MemberEnd();++it) {
+            auto key = it->name.GetString();
+            auto length = it->name.GetStringLength();
+            auto slot = slots_[getSlot(jsonKeyHash(key, length))];
+            if (!slot) {
+                continue;
+            }
+            auto& field = fields_[slot - 1];
+            if (field.length != length || memcmp(field.name, key, length)) {
+                continue;
+            }
+            auto status = field.read(object, it->value);
+            if (!status) {
+                // Innermost field wins, it says the most about what is wrong
+                if (!status.field) {
+                    status.field = field.name;
+                }
+                return status;
+            }
+            seen |= 1u << (slot - 1);
+        }
+        for (size_t i=0;i<N;++i) {
+            if (fields_[i].required && !(seen & (1u << i))) {
+                return JsonStatus{JsonError::MissingField, fields_[i].name};
+            }
+        }
+        return JsonStatus();
+    }
+
+private:
+    JsonField<T>    fields_[N];
+    uint8_t         slots_[kMaxSlots];  // Field index + 1, 0 for none
+    uint32_t        shift_;
+    uint32_t        mask_;
+
+    constexpr uint32_t getSlot(uint32_t hash) const {
+        return (hash >> shift_) & mask_;
+    }
+
+    constexpr bool isPerfect(uint32_t shift, uint32_t mask) const {
+        for (size_t i=0;i<N;++i) {
+            for (size_t j=i+1;j<N;++j) {
+                if (((fields_[i].hash >> shift) & mask) == ((fields_[j].hash >> shift) & mask)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+};
+
+#endif /* jsonFields_h */
@@ -0,0 +1,376 @@
+//
+//  jsonStructuralIndex.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/12/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "jsonStructuralIndex.hpp"
+
+#include <climits>
+#include <cstring>
+#include <cctype>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_INDEX_X86 1
+#include <immintrin.h>
+#endif
+
+static const size_t kBlockSize = 64;
+
+// Bitmasks for one 64 byte block, bit n is byte n
+struct BlockMasks {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t op;        // { } [ ] : ,
+};
+
+using ClassifyFunc = void (*)(const uint8_t *block, BlockMasks& masks);
+
+static void classifyScalar(const uint8_t *block, BlockMasks& masks) {
+    masks = BlockMasks{0, 0, 0};
+    for (size_t i=0;i<kBlockSize;++i) {
+        const uint64_t bit = 1ULL << i;
+        switch (block[i]) {
+            case '\\':
+                masks.backslash |= bit;
+                break;
+            case '"':
+                masks.quote |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks.op |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#if JSON_INDEX_X86
+
+static inline __m128i eq128(__m128i chunk, char c) {
+    return _mm_cmpeq_epi8(chunk, _mm_set1_epi8(c));
+}
+
+static void classifySse2(const uint8_t *block, BlockMasks& masks) {
+    masks = BlockMasks{0, 0, 0};
+    for (size_t i=0;i<kBlockSize;i+=16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+        const __m128i op = _mm_or_si128(_mm_or_si128(_mm_or_si128(eq128(chunk, '{'), eq128(chunk, '}')), _mm_or_si128(eq128(chunk, '['), eq128(chunk, ']'))), _mm_or_si128(eq128(chunk, ':'), eq128(chunk, ',')));
+        masks.backslash |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(eq128(chunk, '\\')))) << i;
+        masks.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(eq128(chunk, '"')))) << i;
+        masks.op |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(op))) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i eq256(__m256i chunk, char c) {
+    return _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const uint8_t *block, BlockMasks& masks) {
+    masks = BlockMasks{0, 0, 0};
+    for (size_t i=0;i<kBlockSize;i+=32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+        const __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(eq256(chunk, '{'), eq256(chunk, '}')), _mm256_or_si256(eq256(chunk, '['), eq256(chunk, ']'))), _mm256_or_si256(eq256(chunk, ':'), eq256(chunk, ',')));
+        masks.backslash |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eq256(chunk, '\\')))) << i;
+        masks.quote |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(eq256(chunk, '"')))) << i;
+        masks.op |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(op))) << i;
+    }
+}
+
+#endif
+
+static std::pair<ClassifyFunc, const char *> selectClassifier() {
+#if JSON_INDEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return std::make_pair(classifyAvx2, "avx2");
+    }
+    return std::make_pair(classifySse2, "sse2");
+#else
+    return std::make_pair(classifyScalar, "scalar");
+#endif
+}
+
+static const std::pair<ClassifyFunc, const char *>& getClassifier() {
+    static const auto classifier = selectClassifier();
+    return classifier;
+}
+
+// Characters escaped by an odd length run of backslashes. carry says whether the previous block ended in one
+static uint64_t findEscaped(uint64_t backslash, uint64_t& carry) {
+    const uint64_t evenBits = 0x5555555555555555ULL;
+    const uint64_t oddBits = ~evenBits;
+    const uint64_t startEdges = backslash & ~(backslash << 1);
+    const uint64_t evenStartMask = evenBits ^ carry;
+    const uint64_t evenStarts = startEdges & evenStartMask;
+    const uint64_t oddStarts = startEdges & ~evenStartMask;
+    const uint64_t evenCarries = backslash + evenStarts;
+    uint64_t oddCarries = backslash + oddStarts;
+    const bool endsOdd = oddCarries < backslash;
+    oddCarries |= carry;
+    carry = endsOdd ? 1 : 0;
+    const uint64_t evenCarryEnds = evenCarries & ~backslash;
+    const uint64_t oddCarryEnds = oddCarries & ~backslash;
+    return (evenCarryEnds & oddBits) | (oddCarryEnds & evenBits);
+}
+
+// Bit n set if an odd number of bits at or below n are set
+static uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+bool JsonStructuralIndex::build(const uint8_t *data, size_t size, std::vector<uint32_t>& index) {
+    index.clear();
+    if (size > UINT32_MAX) {
+        return false;
+    }
+
+    auto classify = getClassifier().first;
+    uint64_t escapeCarry = 0;
+    uint64_t inString = 0;  // All ones if the previous block ended inside a string
+    uint8_t tail[kBlockSize];
+    for (size_t base=0;base<size;base+=kBlockSize) {
+        const uint8_t *block = data + base;
+        if (size - base < kBlockSize) {
+            // Pad the last block with spaces, which are not interesting
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, size - base);
+            block = tail;
+        }
+
+        BlockMasks masks;
+        classify(block, masks);
+        const uint64_t quotes = masks.quote & ~findEscaped(masks.backslash, escapeCarry);
+        // Covers the opening quote up to, but not including, the closing quote
+        const uint64_t stringMask = prefixXor(quotes) ^ inString;
+        inString = static_cast<uint64_t>(static_cast<int64_t>(stringMask) >> 63);
+
+        uint64_t structural = (masks.op & ~stringMask) | quotes;
+        while (structural) {
+            index.push_back(static_cast<uint32_t>(base + __builtin_ctzll(structural)));
+            structural &= structural - 1;
+        }
+    }
+    return inString == 0;
+}
+
+const char *JsonStructuralIndex::getImplementation() {
+    return getClassifier().second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  JsonIndexWalker
+//
+////////////////////////////////////////////////////////////////////////////////
+
+static void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool parseHex4(const char *p, const char *end, uint32_t& out) {
+    if (end - p < 4) {
+        return false;
+    }
+    out = 0;
+    for (int i=0;i<4;++i) {
+        char c = p[i];
+        out <<= 4;
+        if (c >= '0' && c <= '9') {
+            out |= static_cast<uint32_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            out |= static_cast<uint32_t>(c - 'a' + 10);
+        } else if (c >= 'A' && c <= 'F') {
+            out |= static_cast<uint32_t>(c - 'A' + 10);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool JsonIndexWalker::readRawString(std::string_view& out) {
+    if (peek() != '"' || pos_ + 1 >= index_.size()) {
+        failed_ = true;
+        return false;
+    }
+    const auto open = index_[pos_];
+    const auto close = index_[pos_ + 1];
+    if (json_[close] != '"') {
+        failed_ = true;
+        return false;
+    }
+    pos_ += 2;
+    out = std::string_view(json_ + open + 1, close - open - 1);
+    return true;
+}
+
+bool JsonIndexWalker::readString(std::string& out) {
+    if (peek() != '"') {
+        skipValue();
+        return false;
+    }
+    std::string_view raw;
+    if (!readRawString(raw)) {
+        return false;
+    }
+    out.clear();
+    auto escape = raw.find('\\');
+    if (escape == std::string_view::npos) {
+        out.assign(raw.data(), raw.size());
+        return true;
+    }
+
+    out.reserve(raw.size());
+    out.append(raw.data(), escape);
+    const char *p = raw.data() + escape;
+    const char *end = raw.data() + raw.size();
+    while (p < end) {
+        if (*p != '\\') {
+            out += *p++;
+            continue;
+        }
+        if (++p >= end) {
+            failed_ = true;
+            return false;
+        }
+        switch (*p++) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!parseHex4(p, end, cp)) {
+                    failed_ = true;
+                    return false;
+                }
+                p += 4;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    // Surrogate pair
+                    uint32_t low = 0;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u' || !parseHex4(p + 2, end, low) || low < 0xDC00 || low > 0xDFFF) {
+                        failed_ = true;
+                        return false;
+                    }
+                    p += 6;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(out, cp);
+            }
+                break;
+            default:
+                failed_ = true;
+                return false;
+        }
+    }
+    return true;
+}
+
+// Scalars (numbers, true, false, null) don't appear in the index. They sit between the previous structural
+// character and the one at the cursor
+std::string_view JsonIndexWalker::getScalar() const {
+    if (pos_ == 0 || pos_ >= index_.size()) {
+        return std::string_view();
+    }
+    const char *begin = json_ + index_[pos_ - 1] + 1;
+    const char *end = json_ + index_[pos_];
+    while (begin < end && isspace(static_cast<unsigned char>(*begin))) {
+        ++begin;
+    }
+    while (end > begin && isspace(static_cast<unsigned char>(end[-1]))) {
+        --end;
+    }
+    return std::string_view(begin, end - begin);
+}
+
+bool JsonIndexWalker::readUint(uint32_t& out) {
+    auto c = peek();
+    if (c == '{' || c == '[' || c == '"') {
+        skipValue();
+        return false;
+    }
+    auto scalar = getScalar();
+    if (scalar.empty()) {
+        failed_ = true;
+        return false;
+    }
+    uint64_t value = 0;
+    for (auto ch : scalar) {
+        if (ch < '0' || ch > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(ch - '0');
+        if (value > UINT32_MAX) {
+            return false;
+        }
+    }
+    out = static_cast<uint32_t>(value);
+    return true;
+}
+
+void JsonIndexWalker::skipValue() {
+    auto c = peek();
+    if (c == '"') {
+        std::string_view raw;
+        readRawString(raw);
+    } else if (c == '{' || c == '[') {
+        // Strings are a pair of quotes in the index, so only brackets change the depth
+        size_t depth = 0;
+        do {
+            switch (peek()) {
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+                case '}':
+                case ']':
+                    --depth;
+                    break;
+                case '\0':
+                    failed_ = true;
+                    return;
+                default:
+                    break;
+            }
+            ++pos_;
+        } while (depth);
+    } else if (getScalar().empty()) {
+        // Nothing between the separators means there was no value
+        failed_ = true;
+    }
+}
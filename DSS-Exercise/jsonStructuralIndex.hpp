@@ -0,0 +1,118 @@
+//
+//  jsonStructuralIndex.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/12/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef jsonStructuralIndex_hpp
+#define jsonStructuralIndex_hpp
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// First stage of a two stage JSON parse. Scans the input 64 bytes at a time with SIMD (AVX2 or SSE2 when the
+// CPU has them, scalar otherwise) and records the offset of every structural character ({ } [ ] : ,) outside
+// of strings, plus the opening and closing quote of every string. Escaped quotes are handled.
+// The scan does not validate the JSON, that is up to whoever walks the index
+class JsonStructuralIndex {
+public:
+    // index is cleared first. Returns false if the input ends inside a string or is too big to index
+    static bool build(const uint8_t *data, size_t size, std::vector<uint32_t>& index);
+
+    // Which implementation build uses on this machine, eg. "avx2"
+    static const char *getImplementation();
+};
+
+// Second stage. Walks a structural index, letting the caller visit only the parts of the document it cares
+// about and skip the rest without looking at the bytes in between. Any malformed structure sets failed()
+class JsonIndexWalker {
+public:
+    JsonIndexWalker(const char *json, size_t size, const std::vector<uint32_t>& index) : json_(json), size_(size), index_(index), pos_(0), failed_(false) {}
+
+    bool failed() const { return failed_; }
+    bool isObject() const { return peek() == '{'; }
+    bool isArray() const { return peek() == '['; }
+
+    // Calls func(key) for each member of the object at the cursor. Keys are raw (not unescaped).
+    // func must consume the value with one of the read or skip methods
+    template<typename F>
+    void forEachMember(F func) {
+        if (!expect('{')) {
+            return;
+        }
+        if (peek() == '}') {
+            ++pos_;
+            return;
+        }
+        while (!failed_) {
+            std::string_view key;
+            if (!readRawString(key) || !expect(':')) {
+                return;
+            }
+            func(key);
+            if (peek() == ',') {
+                ++pos_;
+            } else {
+                expect('}');
+                return;
+            }
+        }
+    }
+
+    // Calls func() for each element of the array at the cursor. func must consume the element
+    template<typename F>
+    void forEachElement(F func) {
+        if (!expect('[')) {
+            return;
+        }
+        if (peek() == ']') {
+            ++pos_;
+            return;
+        }
+        while (!failed_) {
+            func();
+            if (peek() == ',') {
+                ++pos_;
+            } else {
+                expect(']');
+                return;
+            }
+        }
+    }
+
+    // Unescapes into out. Returns false (without failing the walk) if the value is not a string
+    bool readString(std::string& out);
+    // Returns false (without failing the walk) if the value is not an unsigned number. The value is consumed either way
+    bool readUint(uint32_t& out);
+    void skipValue();
+
+private:
+    const char                      *json_;
+    size_t                          size_;
+    const std::vector<uint32_t>&    index_;
+    size_t                          pos_;
+    bool                            failed_;
+
+    char peek() const {
+        return pos_ < index_.size() ? json_[index_[pos_]] : '\0';
+    }
+
+    bool expect(char c) {
+        if (peek() != c) {
+            failed_ = true;
+            return false;
+        }
+        ++pos_;
+        return true;
+    }
+
+    bool readRawString(std::string_view& out);
+    std::string_view getScalar() const;
+};
+
+#endif /* jsonStructuralIndex_hpp */
@@ -0,0 +1,239 @@
+//
+//  logger.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/11/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "logger.hpp"
+#include "epoch.h"
+
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cstring>
+
+static const uint32_t kRingCapacity = 256;   // Records per thread, must be a power of 2
+static const int64_t kFlushInterval = 20;   // milliseconds
+
+struct LogRecord {
+    LogLevel    level;
+    int64_t     time;       // Microseconds
+    uint32_t    length;
+    char        text[Logger::kMaxMessageLength];
+};
+
+// Single producer (the owning thread), single consumer (the flusher)
+class LogRing {
+public:
+    LogRing() : head_(0), tail_(0), dropped_(0), windowStart_(0), windowCount_(0) {}
+
+    bool push(LogLevel level, int64_t time, const std::string& message, uint32_t maxMessagesPerSecond) {
+        if (level < LogLevel::Warning && maxMessagesPerSecond) {
+            // Fixed one second windows are plenty for keeping a chatty loop from flooding us
+            if (time - windowStart_ >= 1000000) {
+                windowStart_ = time;
+                windowCount_ = 0;
+            }
+            if (windowCount_ >= maxMessagesPerSecond) {
+                ++dropped_;
+                return false;
+            }
+            ++windowCount_;
+        }
+
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= kRingCapacity) {
+            ++dropped_;
+            return false;
+        }
+        auto& record = records_[tail & (kRingCapacity - 1)];
+        record.level = level;
+        record.time = time;
+        record.length = static_cast<uint32_t>(std::min(message.size(), sizeof(record.text)));
+        memcpy(record.text, message.data(), record.length);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename F>
+    void drain(F func) {
+        auto head = head_.load(std::memory_order_relaxed);
+        auto tail = tail_.load(std::memory_order_acquire);
+        while (head != tail) {
+            func(records_[head & (kRingCapacity - 1)]);
+            ++head;
+            head_.store(head, std::memory_order_release);
+        }
+    }
+
+    uint64_t getNumDropped() const { return dropped_; }
+
+private:
+    LogRecord               records_[kRingCapacity];
+    std::atomic<uint32_t>   head_;
+    std::atomic<uint32_t>   tail_;
+    std::atomic<uint64_t>   dropped_;
+
+    // Only touched by the producer
+    int64_t                 windowStart_;
+    uint32_t                windowCount_;
+};
+
+// Shared state of the logger
+class LoggerState {
+public:
+    std::atomic<uint32_t>   level_{static_cast<uint32_t>(LogLevel::Info)};
+    std::atomic<uint32_t>   maxMessagesPerSecond_{0};
+    std::atomic<bool>       running_{false};
+
+    std::mutex                              mutex_;     // Guards rings_ and the flusher
+    std::condition_variable                 cond_;
+    std::vector<std::shared_ptr<LogRing>>   rings_;
+    std::thread                             flusher_;
+    uint64_t                                reportedDropped_ = 0;
+    std::vector<LogRecord>                  pending_;
+
+    ~LoggerState() {
+        // In case shutdown was never called, a joinable thread at exit would terminate us
+        running_ = false;
+        cond_.notify_all();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+    }
+
+    std::shared_ptr<LogRing> getRing() {
+        thread_local std::shared_ptr<LogRing> ring;
+        if (!ring) {
+            ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(mutex_);
+            rings_.push_back(ring);
+        }
+        return ring;
+    }
+
+    // Expects mutex_ to be held
+    void flush() {
+        // Reused between flushes so we aren't allocating at steady state
+        auto& copies = pending_;
+        copies.clear();
+        for (auto& ring : rings_) {
+            ring->drain([&copies](const LogRecord& record) {
+                copies.push_back(record);
+            });
+        }
+        // Interleave threads in the order things happened
+        std::stable_sort(copies.begin(), copies.end(), [](const LogRecord& a, const LogRecord& b) {
+            return a.time < b.time;
+        });
+        for (auto& record : copies) {
+            write(record.level, record.text, record.length);
+        }
+
+        uint64_t dropped = 0;
+        for (auto& ring : rings_) {
+            dropped += ring->getNumDropped();
+        }
+        if (dropped != reportedDropped_) {
+            std::cerr << "Logger dropped " << (dropped - reportedDropped_) << " messages" << std::endl;
+            reportedDropped_ = dropped;
+        }
+        std::cout.flush();
+    }
+
+    static void write(LogLevel level, const char *text, size_t length) {
+        auto& out = level >= LogLevel::Warning ? std::cerr : std::cout;
+        out.write(text, static_cast<std::streamsize>(length));
+        out << '\n';
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (running_) {
+            cond_.wait_for(lock, std::chrono::milliseconds(kFlushInterval));
+            flush();
+        }
+        flush();
+    }
+};
+
+static LoggerState& getState() {
+    static LoggerState state;
+    return state;
+}
+
+void Logger::initialize(LogLevel level, uint32_t maxMessagesPerSecond) {
+    auto& state = getState();
+    state.level_ = static_cast<uint32_t>(level);
+    state.maxMessagesPerSecond_ = maxMessagesPerSecond;
+    std::lock_guard<std::mutex> lock(state.mutex_);
+    if (!state.running_) {
+        state.running_ = true;
+        state.flusher_ = std::thread([&state]() {
+            state.run();
+        });
+    }
+}
+
+void Logger::shutdown() {
+    auto& state = getState();
+    {
+        std::lock_guard<std::mutex> lock(state.mutex_);
+        if (!state.running_) {
+            return;
+        }
+        state.running_ = false;
+    }
+    state.cond_.notify_all();
+    if (state.flusher_.joinable()) {
+        state.flusher_.join();
+    }
+}
+
+bool Logger::isEnabled(LogLevel level) {
+    return static_cast<uint32_t>(level) >= getState().level_.load(std::memory_order_relaxed);
+}
+
+void Logger::log(LogLevel level, const std::string& message) {
+    if (!isEnabled(level)) {
+        return;
+    }
+    auto& state = getState();
+    if (!state.running_) {
+        LoggerState::write(level, message.data(), std::min(message.size(), kMaxMessageLength));
+        return;
+    }
+    state.getRing()->push(level, EpochTime::timeInMicroSec(), message, state.maxMessagesPerSecond_);
+}
+
+uint64_t Logger::getNumDropped() {
+    auto& state = getState();
+    std::lock_guard<std::mutex> lock(state.mutex_);
+    uint64_t dropped = 0;
+    for (auto& ring : state.rings_) {
+        dropped += ring->getNumDropped();
+    }
+    return dropped;
+}
+
+std::string Logger::truncate(const std::string& str, size_t maxLength) {
+    if (str.size() <= maxLength) {
+        return str;
+    }
+    return str.substr(0, maxLength) + "... (" + std::to_string(str.size()) + " bytes)";
+}
+
+std::string Logger::truncate(const std::vector<uint8_t>& buffer, size_t maxLength) {
+    auto length = std::min(buffer.size(), maxLength);
+    std::string str(buffer.begin(), buffer.begin() + length);
+    if (length < buffer.size()) {
+        str += "... (" + std::to_string(buffer.size()) + " bytes)";
+    }
+    return str;
+}
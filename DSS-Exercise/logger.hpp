@@ -0,0 +1,78 @@
+//
+//  logger.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/11/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef logger_hpp
+#define logger_hpp
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sstream>
+
+enum class LogLevel : uint32_t {
+    Debug = 0,
+    Info,
+    Warning,
+    Error,
+    None        // Use as the level to turn logging off
+};
+
+// Asynchronous logger. Each thread writes into its own lock free ring and a background thread drains the rings
+// and does the actual (slow) output, so logging from workers or the render loop costs about a string copy.
+// Debug and Info are rate limited per thread. Messages which can't be queued (ring full or over the rate)
+// are dropped and counted. Warning and Error go to stderr, everything else to stdout.
+//
+// Until initialize is called, and after shutdown, messages are written synchronously
+class Logger {
+public:
+    // Longest message kept, anything beyond is cut off
+    static constexpr size_t kMaxMessageLength = 512;
+
+    static void initialize(LogLevel level, uint32_t maxMessagesPerSecond);
+    // Flushes anything pending and stops the background thread
+    static void shutdown();
+
+    static bool isEnabled(LogLevel level);
+    static void log(LogLevel level, const std::string& message);
+
+    static uint64_t getNumDropped();
+
+    // For logging payloads. Returns at most maxLength characters, noting the full size if cut
+    static std::string truncate(const std::string& str, size_t maxLength);
+    static std::string truncate(const std::vector<uint8_t>& buffer, size_t maxLength);
+};
+
+// Builds a message and logs it when going out of scope, eg.
+//   Log(LogLevel::Info) << "Fetched " << url;
+// Nothing is formatted if the level is disabled
+class Log {
+public:
+    Log() = delete;
+    Log(LogLevel level) : level_(level), enabled_(Logger::isEnabled(level)) {}
+    ~Log() {
+        if (enabled_) {
+            Logger::log(level_, stream_.str());
+        }
+    }
+
+    template<typename T>
+    Log& operator<<(const T& value) {
+        if (enabled_) {
+            stream_ << value;
+        }
+        return *this;
+    }
+
+private:
+    LogLevel            level_;
+    bool                enabled_;
+    std::ostringstream  stream_;
+};
+
+#endif /* logger_hpp */
@@ -21,22 +21,31 @@
 #include "epoch.h"
 #include "rapidjson/document.h"
 #include "utilities.hpp"
+#include "logger.hpp"
 
 #include "feed.hpp"
 #include "carousel.hpp"
 #include "textureService.hpp"
 #include "fontTextService.hpp"
 #include "feedService.hpp"
+#include "dateIndex.hpp"
+#include "feedParser.hpp"
+#include "feedSnapshot.hpp"
+#include "compactFeed.hpp"
+#include "jsonStructuralIndex.hpp"
 #include "resourceFetcherService.hpp"
+#include "sessionArchive.hpp"
 #include "carousel.hpp"
 #include "dateSelector.hpp"
 #include "input.hpp"
 #include "uiOverlay.hpp"
+#include "browseGrid.hpp"
 #include "displayList.hpp"
 
 #include <future>
 #include <memory>
 #include <functional>
+#include <random>
 
 // Non-static here just for convenience for usage in Carousel
 extern const int32_t SCREEN_WIDTH = 1920;
@@ -47,6 +56,8 @@ extern const int32_t DATE_SELECTOR_Y = 220;
 
 extern const int ThumbnailWidth = 480;
 extern const int ThumbnailHeight = 270;
+// Unfocused thumbnails are drawn at this scale of the focused one
+static const double kThumbnailScaleDown = 0.66667;
 
 extern const std::string kTextureKeyLeft = "key-left";
 extern const std::string kTextureKeyRight = "key-right";
@@ -66,6 +77,16 @@ static const std::string kTextureAssetBkg = "1.jpg";
 static const std::string kTextureAssetLoading = "loading.png";
 static const std::string kTextureAssetLinkError = "link-error.png";
 
+// Thumbnails are served from here. Along with the feed host, we warm connections to it at startup
+static const std::string kImageCdnUrl = "https://img.mlbstatic.com";
+
+// Per thread, for Debug and Info
+static const uint32_t kMaxLogMessagesPerSecond = 200;
+
+static const uint32_t kBenchParseIterations = 20;
+// Lives in the cache:// directory
+static const std::string kFeedSnapshotName = "feeds.snapshot";
+
 static const std::string kInitializingStringKey = "initializing";
 static const std::string kInitializingStringValue = "Initializing...";
 static const FontTextService::Font kInitializingStringFont = FontTextService::Font::Roboto48;
@@ -132,26 +153,113 @@ std::string getCurrentWorkingDirectory() {
     }
 }
 
-bool initializeMinimalBakedGoods(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, const std::string& cwd, bool verbose) {
+// Baked textures are small, so read them once and keep them resident. Textures are then created from mem://
+// urls, which complete inline on the calling thread rather than being re-read from disk on the worker pool
+bool preloadBakedGoods(const std::shared_ptr<ResourceFetcherService>& fetcher, const std::string& cwd) {
+    const std::vector<std::string> assets = {
+        kTextureAssetBkg,
+        kTextureAssetLeft,
+        kTextureAssetRight,
+        kTextureAssetUp,
+        kTextureAssetDown,
+        kTextureAssetLoading,
+        kTextureAssetLinkError
+    };
+    auto memory = fetcher->getMemoryHandler();
+    for (auto& asset : assets) {
+        if (!memory->preloadFile(asset, cwd + "/baked/" + asset)) {
+            Log(LogLevel::Error) << "ERROR: Could not preload baked good " << asset;
+            return false;
+        }
+        Log(LogLevel::Info) << "Preloaded baked good " << asset;
+    }
+    return true;
+}
+
+// Parses a saved feed response with each parser and reports throughput
+int benchmarkParse(const std::string& path) {
+    auto [error, buffer] = FileSchemeHandler::loadFile(path);
+    if (error != Error::None) {
+        std::cerr << "Could not read " << path << std::endl;
+        return 1;
+    }
+
+    using Parser = std::function<std::pair<Error, std::shared_ptr<Feed>>(const std::string&, std::vector<uint8_t>&)>;
+    const std::vector<std::pair<std::string, Parser>> parsers = {
+        { "DOM", FeedParser::parseDom },
+        { "SAX", FeedParser::parseSax },
+        { std::string("Indexed (") + JsonStructuralIndex::getImplementation() + ")", FeedParser::parseIndexed }
+    };
+    const double megabytes = static_cast<double>(buffer.size()) / (1024.0 * 1024.0);
+    std::cout << "Parsing " << path << " (" << buffer.size() << " bytes) " << kBenchParseIterations << " times" << std::endl;
+    // Parsing is in place, so each iteration works on a fresh copy. The copy is included in the time, but is
+    // the same for both parsers
+    std::vector<uint8_t> scratch;
+    scratch.reserve(buffer.size() + 1);
+    for (auto& parser : parsers) {
+        size_t numRecaps = 0;
+        auto start = EpochTime::timeInMicroSec();
+        for (auto i=0u;i<kBenchParseIterations;++i) {
+            scratch.assign(buffer.begin(), buffer.end());
+            auto [parseError, feed] = parser.second("bench", scratch);
+            if (parseError != Error::None || !feed) {
+                std::cerr << parser.first << " parse failed" << std::endl;
+                return 1;
+            }
+            numRecaps = feed->getNumRecaps();
+        }
+        auto seconds = static_cast<double>(EpochTime::timeInMicroSec() - start) / 1000000.0;
+        std::cout << parser.first << ": " << (seconds * 1000.0 / kBenchParseIterations) << "ms per parse, " << (megabytes * kBenchParseIterations / seconds) << " MB/s, " << numRecaps << " recaps" << std::endl;
+    }
+    return 0;
+}
+
+int reportFeedMemory(const std::string& path) {
+    auto [error, buffer] = FileSchemeHandler::loadFile(path);
+    if (error != Error::None) {
+        std::cerr << "Could not read " << path << std::endl;
+        return 1;
+    }
+    auto [parseError, feed] = FeedParser::parseIndexed("report", buffer);
+    if (parseError != Error::None || !feed) {
+        std::cerr << "Could not parse " << path << std::endl;
+        return 1;
+    }
+
+    auto report = CompactFeed::getMemoryReport(feed);
+    auto perRecap = [&report](size_t bytes) {
+        return report.recaps ? bytes / report.recaps : 0;
+    };
+    std::cout << "Feed from " << path << ", " << report.recaps << " recaps" << std::endl;
+    std::cout << "Feed:        " << report.feedBytes << " bytes (" << perRecap(report.feedBytes) << " per recap) in " << report.feedAllocations << " allocations" << std::endl;
+    std::cout << "CompactFeed: " << report.compactBytes << " bytes (" << perRecap(report.compactBytes) << " per recap) in " << report.compactAllocations << " allocations" << std::endl;
+    std::cout << "Strings:     " << report.stringBytes << " bytes, " << report.uniqueStringBytes << " after deduplication" << std::endl;
+    if (report.compactBytes) {
+        std::cout << "Ratio:       " << static_cast<double>(report.feedBytes) / report.compactBytes << "x" << std::endl;
+    }
+    return 0;
+}
+
+bool initializeMinimalBakedGoods(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, const std::string& cwd) {
     bool success = true;
     std::future<bool> future;
     std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
     future = promise->get_future();
     
-    std::string asset = "file://" + cwd + "/baked/" + kTextureAssetBkg;
-    texService->createTexture(kTextureKeyBkg, asset, [asset, promise, verbose](Error error, std::shared_ptr<Texture> texture) {
+    std::string asset = "mem://" + kTextureAssetBkg;
+    texService->createTexture(kTextureKeyBkg, asset, [asset, promise](Error error, std::shared_ptr<Texture> texture) {
         if (error != Error::None) {
-            std::cerr << "ERROR: Could not create baked good " << asset << std::endl;
-        } else if (verbose) {
-            std::cout << "Created baked texture " << asset << std::endl;
+            Log(LogLevel::Error) << "ERROR: Could not create baked good " << asset;
+        } else {
+            Log(LogLevel::Info) << "Created baked texture " << asset;
         }
         promise->set_value(error == Error::None);
     });
     if (!fontTextService->addString(kInitializingStringFont, kInitializingStringKey, kInitializingStringValue, { 0xFF, 0xFF, 0xFF, 0xFF })) {
-        std::cerr << "Could not create string '" << kInitializingStringValue << "'" << std::endl;
+        Log(LogLevel::Error) << "Could not create string '" << kInitializingStringValue << "'";
         return false;
     } else if (!fontTextService->addString(kLoadingStringFont, kLoadingStringKey, kLoadingStringValue, { 0xFF, 0xFF, 0xFF, 0xFF })) {
-        std::cerr << "Could not create string '" << kLoadingStringValue << "'" << std::endl;
+        Log(LogLevel::Error) << "Could not create string '" << kLoadingStringValue << "'";
         return false;
     }
     if (!future.get()) {
@@ -160,7 +268,7 @@ bool initializeMinimalBakedGoods(const std::shared_ptr<TextureService>& texServi
     return success;
 }
 
-std::vector<std::shared_future<bool>> initializeBakedGoods(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, const std::string& cwd, bool verbose) {
+std::vector<std::shared_future<bool>> initializeBakedGoods(const std::shared_ptr<TextureService>& texService, const std::shared_ptr<FontTextService>& fontTextService, const std::shared_ptr<FeedService>& feedService, const std::string& cwd, int64_t launchTime) {
     const std::string left = "file://" + cwd + "/baked/key-left.png";
     const std::string bkg = "file://" + cwd + "/baked/1.jpg";
     std::vector<std::pair<std::string, std::string>> bakedTextures = {
@@ -177,13 +285,13 @@ std::vector<std::shared_future<bool>> initializeBakedGoods(const std::shared_ptr
         std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
         futures.push_back(promise->get_future());
         
-        std::string asset = "file://" + cwd + "/baked/" + bt.second;
-        texService->createTexture(bt.first, asset, [asset, promise, verbose](Error error, std::shared_ptr<Texture> texture) {
+        std::string asset = "mem://" + bt.second;
+        texService->createTexture(bt.first, asset, [asset, promise](Error error, std::shared_ptr<Texture> texture) {
             promise->set_value(error == Error::None);
             if (error != Error::None) {
-                std::cerr << "ERROR: Could not create baked good " << asset << std::endl;
-            } else if (verbose) {
-                std::cout << "Created baked texture " << asset << std::endl;
+                Log(LogLevel::Error) << "ERROR: Could not create baked good " << asset;
+            } else {
+                Log(LogLevel::Info) << "Created baked texture " << asset;
             }
         });
     }
@@ -191,12 +299,13 @@ std::vector<std::shared_future<bool>> initializeBakedGoods(const std::shared_ptr
     // Prime our initial feed
     std::shared_ptr<std::promise<bool>> promise = std::make_shared<std::promise<bool>>();
     futures.push_back(promise->get_future());
-    feedService->fetchFeed(feedService->getDefaultDate(), [promise, verbose](Error error, uint32_t status, std::shared_ptr<Feed> feed) {
+    feedService->fetchFeed(feedService->getDefaultDate(), [promise, launchTime](Error error, uint32_t status, std::shared_ptr<Feed> feed) {
         promise->set_value(error == Error::None);
         if (error != Error::None) {
-            std::cerr << "ERROR: Could not fetch initial feed" << std::endl;
-        } else if (verbose) {
-            std::cout << "Fetched initial feed" << std::endl;
+            Log(LogLevel::Error) << "ERROR: Could not fetch initial feed";
+        } else {
+            Log(LogLevel::Info) << "Fetched initial feed";
+            Log(LogLevel::Info) << "Time to first feed: " << (EpochTime::timeInMilliSec() - launchTime) << "ms";
         }
     });
     
@@ -204,12 +313,14 @@ std::vector<std::shared_future<bool>> initializeBakedGoods(const std::shared_ptr
 }
 
 int main(int argc, const char * argv[]) {
+    int64_t launchTime = EpochTime::timeInMilliSec();
     SDL_Window* window = nullptr;
     SDL_Renderer *renderer = nullptr;
     std::shared_ptr<TextureService> texService;
     std::shared_ptr<FontTextService> fontTextService;
     std::shared_ptr<ResourceFetcherService> resourceFetcherService;
     std::shared_ptr<FeedService> feedService;
+    std::shared_ptr<FeedSnapshot> feedSnapshot;
     std::string workingDirectory;
     std::string execFullname = argv[0];
     std::vector<std::string> parts;
@@ -220,9 +331,42 @@ int main(int argc, const char * argv[]) {
     args::Flag verboseFlag(parser, "verbose", "Verbose output", {"verbose"});
     args::ValueFlag<uint32_t> numWorkersArg(parser, "num_workers", "Number of Resource Fetcher Worker Threads", {"num_workers"});
     args::ValueFlag<uint32_t> stressArg(parser, "stress", "Number of seconds to sleep after network call to stress system", {"stress"});
+    args::Flag noPrewarmFlag(parser, "no_prewarm", "Do not prewarm connections to the feed and image hosts at startup", {"no_prewarm"});
+    args::Flag noSnapshotFlag(parser, "no_snapshot", "Do not show feeds saved by the previous run while fresh ones are fetched", {"no_snapshot"});
+    args::ValueFlag<std::string> fetchTraceArg(parser, "fetch_trace", "On exit, write per-request fetch timings as JSONL to this file", {"fetch_trace"});
+    args::ValueFlag<std::string> recordArg(parser, "record", "Record every network response to this file, written on exit", {"record"});
+    args::ValueFlag<std::string> replayArg(parser, "replay", "Serve network requests from a file written by --record", {"replay"});
+    args::ValueFlag<double> replayScaleArg(parser, "replay_scale", "Multiplier applied to recorded response times when replaying. 0 means no delay", {"replay_scale"});
+    args::ValueFlag<uint32_t> prefetchRadiusArg(parser, "prefetch_radius", "Number of dates on either side of the current one to prefetch. 0 disables prefetching", {"prefetch_radius"});
+    args::ValueFlag<uint32_t> feedCacheSizeArg(parser, "feed_cache_size", "Maximum number of feeds kept in memory", {"feed_cache_size"});
+    args::ValueFlag<uint32_t> feedCacheMbArg(parser, "feed_cache_mb", "Maximum megabytes of feeds, including their text and thumbnails, kept in memory", {"feed_cache_mb"});
+    args::ValueFlag<uint32_t> refreshIntervalArg(parser, "refresh_interval", "Seconds between refreshes of the feed on screen. 0 disables refreshing", {"refresh_interval"});
+    args::ValueFlag<std::string> firstDateArg(parser, "first_date", "First date that can be browsed, YYYY-MM-DD", {"first_date"});
+    args::ValueFlag<std::string> lastDateArg(parser, "last_date", "Last date that can be browsed, YYYY-MM-DD", {"last_date"});
+    args::ValueFlag<std::string> dateArg(parser, "date", "Date shown at startup, YYYY-MM-DD", {"date"});
+    args::Flag gridFlag(parser, "grid", "Browse every date at once, one row of games per date", {"grid"});
+    args::ValueFlag<std::string> benchParseArg(parser, "bench_parse", "Benchmark the feed parsers against a saved feed response and exit", {"bench_parse"});
+    args::ValueFlag<std::string> memoryReportArg(parser, "memory_report", "Compare the memory used by a saved feed response as a Feed and as a CompactFeed, and exit", {"memory_report"});
     bool verbose = false;
+    bool prewarm = true;
+    bool useSnapshot = true;
+    bool grid = false;
+    std::string fetchTracePath;
+    std::string recordPath;
+    std::string replayPath;
+    double replayScale = 1.0;
+    std::shared_ptr<SessionArchive> sessionArchive;
     uint32_t numWorkers = 4;
     uint32_t stress = 0;
+    uint32_t prefetchRadius = 1;
+    uint32_t feedCacheSize = 5;
+    uint32_t feedCacheMb = 64;
+    uint32_t refreshInterval = 300;
+    // The 2022 regular season
+    std::string firstDate = "2022-04-07";
+    std::string lastDate = "2022-10-05";
+    std::string defaultDate = "2022-05-04";
+    std::shared_ptr<DateIndex> dateIndex;
 
     // Parse arguments. Utilize separate try/catch to compartmentalize exception handling
     try {
@@ -257,15 +401,126 @@ int main(int argc, const char * argv[]) {
         if (stressArg) {
             stress = args::get(stressArg);
         }
+        if (prefetchRadiusArg) {
+            prefetchRadius = args::get(prefetchRadiusArg);
+        }
+        if (feedCacheSizeArg) {
+            feedCacheSize = args::get(feedCacheSizeArg);
+            if (feedCacheSize == 0) {
+                feedCacheSize = 1;
+                std::cerr << "Trying to set feed cache size to 0 ... forcing value to 1" << std::endl;
+            }
+        }
+        if (feedCacheMbArg) {
+            feedCacheMb = args::get(feedCacheMbArg);
+        }
+        if (refreshIntervalArg) {
+            refreshInterval = args::get(refreshIntervalArg);
+        }
+        if (args::get(noPrewarmFlag)) {
+            prewarm = false;
+        }
+        if (args::get(noSnapshotFlag)) {
+            useSnapshot = false;
+        }
+        if (args::get(gridFlag)) {
+            grid = true;
+        }
+        if (fetchTraceArg) {
+            fetchTracePath = args::get(fetchTraceArg);
+        }
+        if (recordArg) {
+            recordPath = args::get(recordArg);
+        }
+        if (replayArg) {
+            replayPath = args::get(replayArg);
+        }
+        if (replayScaleArg) {
+            replayScale = std::max(0.0, args::get(replayScaleArg));
+        }
+        if (firstDateArg) {
+            firstDate = args::get(firstDateArg);
+        }
+        if (lastDateArg) {
+            lastDate = args::get(lastDateArg);
+        }
+        if (dateArg) {
+            defaultDate = args::get(dateArg);
+        }
+        // Throws if either date is malformed
+        dateIndex = std::make_shared<DateIndex>(firstDate, lastDate);
+        if (dateIndex->findDate(defaultDate) < 0) {
+            std::cerr << "Date " << defaultDate << " must be between " << firstDate << " and " << lastDate << std::endl;
+            return 1;
+        }
+        if (recordPath.size() && replayPath.size()) {
+            std::cerr << "Cannot use --record and --replay together" << std::endl;
+            return 1;
+        }
         workingDirectory = getCurrentWorkingDirectory();
     } catch (std::exception& e) {
         std::cerr << e.what() << std::endl;
         return 1;
     }
 
+    // Fetch, parse and render paths log through here so verbose output doesn't stall them
+    Logger::initialize(verbose ? LogLevel::Info : LogLevel::Warning, kMaxLogMessagesPerSecond);
+
+    if (benchParseArg) {
+        return benchmarkParse(args::get(benchParseArg));
+    }
+    if (memoryReportArg) {
+        return reportFeedMemory(args::get(memoryReportArg));
+    }
+
+    if (replayPath.size()) {
+        sessionArchive = std::make_shared<SessionArchive>();
+        if (!sessionArchive->load(replayPath)) {
+            std::cerr << "Could not load session from " << replayPath << std::endl;
+            return 1;
+        }
+        // Run on the recording's clock so the session plays out the same way. Replayed responses are never retried,
+        // so the recording's backoff seed isn't needed
+        auto offset = (sessionArchive->getStartTime() - launchTime) * 1000;
+        EpochTime::setOffsetInMicroSec(offset);
+        launchTime += offset / 1000;
+        if (verbose) {
+            std::cout << "Replaying " << sessionArchive->getNumEntries() << " responses from " << replayPath << std::endl;
+        }
+    } else if (recordPath.size()) {
+        auto seed = static_cast<uint64_t>(std::random_device{}());
+        // Saved with the responses, so the retry delays the recording saw can be worked out again
+        sessionArchive = std::make_shared<SessionArchive>(launchTime, seed);
+        HttpSchemeHandler::setBackoffSeed(seed);
+    }
+
     OPENSSL_init();
     init_locks();
 
+    // The fetcher does not rely on SDL, so bring it up first. That way connections to our hosts
+    // are being warmed up while SDL and fonts are initializing
+    try {
+        resourceFetcherService = std::make_shared<ResourceFetcherService>(numWorkers, stress, verbose);
+        if (replayPath.size()) {
+            auto replayHandler = std::make_shared<ReplaySchemeHandler>(sessionArchive, replayScale);
+            resourceFetcherService->registerSchemeHandler("http", replayHandler);
+            resourceFetcherService->registerSchemeHandler("https", replayHandler);
+        } else if (recordPath.size()) {
+            resourceFetcherService->startRecording(sessionArchive);
+        }
+    } catch (std::exception& e) {
+        std::cerr << "Exception creating resource fetcher: " << e.what() << std::endl;
+        return 1;
+    }
+    if (prewarm) {
+        resourceFetcherService->prewarm({ FeedService::getFeedHostUrl(), kImageCdnUrl });
+    }
+    if (!preloadBakedGoods(resourceFetcherService, workingDirectory)) {
+        std::cerr << "Could not initialize " << execName << std::endl;
+        std::cerr << "Is the `baked` directory in the same directory as " << execName << "?" << std::endl;
+        return 1;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "Could not initialize SDL2: " << SDL_GetError() << std::endl;
         return 1;
@@ -290,12 +545,38 @@ int main(int argc, const char * argv[]) {
     // Use Linear Filtering, since we are scaling down textures
     SDL_SetHint( SDL_HINT_RENDER_SCALE_QUALITY, "1" );
     
+    // Tiles are the size of the carousel's unfocused thumbnails, so they get the same cut
+    BrowseGridConfig gridConfig{64, 48, SCREEN_WIDTH - 128, SCREEN_HEIGHT - 96, static_cast<int>(ThumbnailWidth * kThumbnailScaleDown), static_cast<int>(ThumbnailHeight * kThumbnailScaleDown), 24, 56, 16, 4, 1, 3, static_cast<int>(ThumbnailWidth * 2.75), { 0x40, 0x40, 0x40, 0x90 }, { 0xFF, 0xFF, 0xFF, 0xFF }};
+    if (grid) {
+        // The grid fetches the rows around the viewport itself, and every one of them has to fit in the cache
+        prefetchRadius = 0;
+        feedCacheSize = std::max(feedCacheSize, static_cast<uint32_t>(BrowseGrid::getMaxLiveRows(gridConfig)));
+    }
+
     // Initializing services that rely on SDL being initialized
     try {
-        resourceFetcherService = std::make_shared<ResourceFetcherService>(numWorkers, stress, verbose);
         texService = std::make_shared<TextureService>(renderer, resourceFetcherService, verbose);
         fontTextService = std::make_shared<FontTextService>(texService, verbose);
-        feedService = std::make_shared<FeedService>(resourceFetcherService, texService, fontTextService, ThumbnailWidth, verbose);
+        feedService = std::make_shared<FeedService>(resourceFetcherService, texService, fontTextService, dateIndex, defaultDate, ThumbnailWidth, verbose);
+        feedService->setPrefetchRadius(prefetchRadius);
+        feedService->setCacheBudget(feedCacheSize, static_cast<size_t>(feedCacheMb) * 1024 * 1024);
+        feedService->setRefreshInterval(static_cast<int64_t>(refreshInterval) * 1000);
+        // The carousel and the grid only load the thumbnails near the screen
+        feedService->setThumbnailsOnDemand(true);
+        // Thumbnail cuts are picked in output pixels, which is more than the window's size on a high density display
+        int windowW = 0;
+        int outputW = 0;
+        SDL_GetWindowSize(window, &windowW, nullptr);
+        SDL_GetRendererOutputSize(renderer, &outputW, nullptr);
+        double outputScale = windowW > 0 && outputW > 0 ? static_cast<double>(outputW) / windowW : 1.0;
+        feedService->setThumbnailSize(static_cast<uint32_t>(ThumbnailWidth * outputScale), static_cast<uint32_t>(ThumbnailHeight * outputScale), kThumbnailScaleDown);
+        if (useSnapshot) {
+            feedSnapshot = std::make_shared<FeedSnapshot>(resourceFetcherService->getCacheHandler()->getPath(kFeedSnapshotName));
+            if (feedSnapshot->load()) {
+                Log(LogLevel::Info) << "Loaded feed snapshot";
+            }
+            feedService->setSnapshot(feedSnapshot);
+        }
     } catch (std::exception& e) {
         // TODO: Services will throw, need to throw on error (in particular fontTextService)
         std::cerr << "Exception creating services: " << e.what() << std::endl;
@@ -306,7 +587,7 @@ int main(int argc, const char * argv[]) {
 
     // Initialized baked assets
     // We block until this is done
-    if (!initializeMinimalBakedGoods(texService, fontTextService, feedService, workingDirectory, verbose)) {
+    if (!initializeMinimalBakedGoods(texService, fontTextService, feedService, workingDirectory)) {
         std::cerr << "Could not initialize " << execName << std::endl;
         std::cerr << "Is the `baked` directory in the same directory as " << execName << "?" << std::endl;
         return 1;
@@ -327,6 +608,7 @@ int main(int argc, const char * argv[]) {
         std::shared_ptr<Carousel> carousel;
         std::shared_ptr<DateSelector> dateSelector;
         std::unique_ptr<UiOverlay> uiOverlay;
+        std::unique_ptr<BrowseGrid> browseGrid;
         
         while (!quit) {
             Input input;
@@ -357,17 +639,23 @@ int main(int argc, const char * argv[]) {
             }
 
             if (!quit) {
+                // Textures the display list points at stay alive until it has been rendered
+                EpochReclaimer::ReadGuard frameGuard;
                 displaylist->clear();
                 displaylist->addTexture(bkgTex, SCREEN_WIDTH/2, SCREEN_HEIGHT/2);
                 
                 if (nextState != state) {
                     switch (nextState) {
                         case DemoState::Initializing: {
-                            initializingFutures = initializeBakedGoods(texService, fontTextService, feedService, workingDirectory, verbose);
+                            initializingFutures = initializeBakedGoods(texService, fontTextService, feedService, workingDirectory, launchTime);
                         }
                             break;
                         case DemoState::Ready: {
-                            carousel = std::make_shared<Carousel>(CarouselConfig{SCREEN_HEIGHT / 2, 0.66667, ThumbnailWidth, ThumbnailHeight, 32, 4, 4, static_cast<int>(ThumbnailWidth * 2.75), { 0x40, 0x40, 0x40, 0x90 }, { 0xFF, 0xFF, 0xFF, 0xFF }}, texService, fontTextService, verbose);
+                            if (grid) {
+                                browseGrid.reset(new BrowseGrid(gridConfig, texService, fontTextService, feedService, verbose));
+                                break;
+                            }
+                            carousel = std::make_shared<Carousel>(CarouselConfig{SCREEN_HEIGHT / 2, kThumbnailScaleDown, ThumbnailWidth, ThumbnailHeight, 32, 4, 4, static_cast<int>(ThumbnailWidth * 2.75), { 0x40, 0x40, 0x40, 0x90 }, { 0xFF, 0xFF, 0xFF, 0xFF }}, texService, fontTextService, feedService, verbose);
                             dateSelector = std::make_shared<DateSelector>(texService, fontTextService, feedService, carousel, DATE_SELECTOR_X, DATE_SELECTOR_Y, verbose);
                             uiOverlay.reset(new UiOverlay(texService, fontTextService, carousel, dateSelector, SCREEN_WIDTH, SCREEN_HEIGHT, stress, numWorkers));
                             auto feed = feedService->getFeed(feedService->getDefaultDate());
@@ -413,6 +701,9 @@ int main(int argc, const char * argv[]) {
                         }
                             break;
                         case DemoState::Ready: {
+                            if (browseGrid) {
+                                browseGrid->update(dt, displaylist, input);
+                            }
                             if (dateSelector) {
                                 dateSelector->update(dt, displaylist, input);
                             }
@@ -432,16 +723,50 @@ int main(int argc, const char * argv[]) {
             }
         }
     } catch (std::exception& e) {
-        std::cerr << e.what() << std::endl;
+        Log(LogLevel::Error) << e.what();
     }
     
     delete displaylist;
-    
+
+    // Everything below prints directly, so get whatever is still queued out first
+    Logger::shutdown();
+
+    auto trace = resourceFetcherService->getFetchTrace();
+    if (verbose) {
+        for (auto& summary : trace->getHostSummaries()) {
+            std::cout << "Host " << summary.host << ": " << summary.count << " requests, " << summary.failures << " failures, " << summary.retries << " retries, " << summary.bytes << " bytes" << std::endl;
+            std::cout << "    avg queue " << summary.avgQueueWait << "s, dns " << summary.avgNameLookup << "s, connect " << summary.avgConnect << "s, tls " << summary.avgAppConnect << "s, first byte " << summary.avgStartTransfer << "s, total " << summary.avgTotal << "s (max " << summary.maxTotal << "s)" << std::endl;
+        }
+    }
+    if (verbose) {
+        for (auto& share : resourceFetcherService->getTransferScheduler()->getBandwidthShares()) {
+            std::cout << "Priority " << TransferScheduler::getPriorityName(share.priority) << ": " << share.bytes << " bytes, " << share.contendedBytes << " bytes contended (" << (share.contendedShare * 100.0) << "% of contended bandwidth)" << std::endl;
+        }
+        auto prefetch = feedService->getPrefetchStats();
+        auto cache = feedService->getCacheStats();
+        std::cout << "Feed cache: " << cache.feeds << " feeds, " << cache.bytes << " bytes, " << cache.evictions << " evictions" << std::endl;
+        std::cout << "Prefetch: " << prefetch.hits << "/" << prefetch.feeds << " feeds used (" << (prefetch.hitRatio * 100.0) << "% hit ratio), " << prefetch.bytes << " bytes, " << prefetch.wastedBytes << " bytes wasted" << std::endl;
+    }
+    if (fetchTracePath.size() && !trace->exportJsonl(fetchTracePath)) {
+        std::cerr << "Could not write fetch trace to " << fetchTracePath << std::endl;
+    }
+
     // Destroy our services in reverse order
     feedService = nullptr;
+    // Waits for the last snapshot write
+    feedSnapshot = nullptr;
     fontTextService = nullptr;
     texService = nullptr;
     resourceFetcherService = nullptr;
+
+    // Workers are gone, so the recording is complete
+    if (recordPath.size()) {
+        if (!sessionArchive->save(recordPath)) {
+            std::cerr << "Could not write session to " << recordPath << std::endl;
+        } else if (verbose) {
+            std::cout << "Recorded " << sessionArchive->getNumEntries() << " responses to " << recordPath << std::endl;
+        }
+    }
     
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
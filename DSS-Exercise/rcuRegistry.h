@@ -0,0 +1,237 @@
+//
+//  rcuRegistry.h
+//
+//  Created by Benjamin Lee on 6/16/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef rcuRegistry_h
+#define rcuRegistry_h
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+
+// Epoch based reclamation shared by every RcuRegistry. Readers announce the epoch they entered in, and anything
+// a writer retires is only freed once no reader could still be looking at it.
+// Each reading thread claims a slot the first time it reads. Past kMaxThreads, readers fall back to a shared
+// counter which is still wait-free but holds up all reclamation while any of them are reading
+class EpochReclaimer {
+public:
+    static constexpr size_t kMaxThreads = 128;
+
+    static EpochReclaimer& get() {
+        static EpochReclaimer reclaimer;
+        return reclaimer;
+    }
+
+    // Read side critical section. May be nested
+    class ReadGuard {
+    public:
+        ReadGuard() { EpochReclaimer::get().enter(); }
+        ~ReadGuard() { EpochReclaimer::get().exit(); }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+    };
+
+    // Called by a writer after it has published a new version. Returns the epoch the old version is retired in
+    uint64_t retire() {
+        return epoch_.fetch_add(1);
+    }
+
+    // Anything retired in an epoch before this can be freed
+    uint64_t getSafeEpoch() {
+        if (overflowReaders_.load()) {
+            return 0;
+        }
+        uint64_t safe = std::numeric_limits<uint64_t>::max();
+        for (auto& slot : slots_) {
+            auto epoch = slot.epoch.load();
+            if (epoch && epoch < safe) {
+                safe = epoch;
+            }
+        }
+        return safe;
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t>   epoch{0};       // 0 when not reading
+        std::atomic<bool>       claimed{false};
+    };
+
+    // Per thread, gives the slot back when the thread exits
+    struct ThreadState {
+        Slot        *slot = nullptr;
+        uint32_t    depth = 0;
+        bool        registered = false;
+
+        ~ThreadState() {
+            if (slot) {
+                slot->claimed.store(false);
+            }
+        }
+    };
+
+    std::atomic<uint64_t>   epoch_{1};
+    std::atomic<uint32_t>   overflowReaders_{0};
+    Slot                    slots_[kMaxThreads];
+
+    static ThreadState& getThreadState() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    void enter() {
+        auto& state = getThreadState();
+        if (state.depth++) {
+            return;
+        }
+        if (!state.registered) {
+            state.registered = true;
+            for (auto& slot : slots_) {
+                bool unclaimed = false;
+                if (slot.claimed.compare_exchange_strong(unclaimed, true)) {
+                    state.slot = &slot;
+                    break;
+                }
+            }
+        }
+        // Sequentially consistent, so a writer that doesn't see us yet has already published what we are about to read
+        if (state.slot) {
+            state.slot->epoch.store(epoch_.load());
+        } else {
+            overflowReaders_.fetch_add(1);
+        }
+    }
+
+    void exit() {
+        auto& state = getThreadState();
+        if (--state.depth) {
+            return;
+        }
+        if (state.slot) {
+            state.slot->epoch.store(0, std::memory_order_release);
+        } else {
+            overflowReaders_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+};
+
+// Read-copy-update map for read mostly lookups. Readers never block: they read whichever version of the map is
+// current. Writers are serialized, copy the map, make their change and publish the copy. The old version is
+// freed once EpochReclaimer says no reader can still be using it.
+// Values are returned by copy, so Value is typically a shared_ptr
+template<typename Key, typename Value>
+class RcuRegistry {
+public:
+    using Map = std::unordered_map<Key, Value>;
+
+    RcuRegistry() : map_(new Map()) {}
+    // There must be no readers left
+    ~RcuRegistry() {
+        delete map_.load();
+        for (auto& retired : retired_) {
+            delete retired.second;
+        }
+    }
+
+    RcuRegistry(const RcuRegistry&) = delete;
+    RcuRegistry& operator=(const RcuRegistry&) = delete;
+
+    Value find(const Key& key) const {
+        EpochReclaimer::ReadGuard guard;
+        auto map = map_.load();
+        auto it = map->find(key);
+        return it != map->end() ? it->second : Value();
+    }
+
+    size_t size() const {
+        EpochReclaimer::ReadGuard guard;
+        return map_.load()->size();
+    }
+
+    // f(key, value) sees a consistent version of the map, though it may already be out of date
+    template<typename F>
+    void forEach(F f) const {
+        EpochReclaimer::ReadGuard guard;
+        for (auto& it : *map_.load()) {
+            f(it.first, it.second);
+        }
+    }
+
+    void insert(const Key& key, const Value& value) {
+        update([&key, &value](Map& map) {
+            map[key] = value;
+            return true;
+        });
+    }
+
+    bool erase(const Key& key) {
+        return update([&key](Map& map) {
+            return map.erase(key) > 0;
+        });
+    }
+
+    // Erases the first entry holding value
+    bool eraseValue(const Value& value) {
+        return update([&value](Map& map) {
+            for (auto it = map.begin();it != map.end();++it) {
+                if (it->second == value) {
+                    map.erase(it);
+                    return true;
+                }
+            }
+            return false;
+        });
+    }
+
+    void clear() {
+        update([](Map& map) {
+            bool changed = !map.empty();
+            map.clear();
+            return changed;
+        });
+    }
+
+    // f(Map&) changes a private copy of the map and returns whether it changed anything. Nothing is published if not.
+    // Every write copies the whole map, so batch changes together where possible
+    template<typename F>
+    bool update(F f) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        auto current = map_.load();
+        std::unique_ptr<Map> next(new Map(*current));
+        if (!f(*next)) {
+            return false;
+        }
+        map_.store(next.release());
+        retired_.emplace_back(EpochReclaimer::get().retire(), current);
+        reclaim();
+        return true;
+    }
+
+private:
+    std::atomic<Map *>                      map_;
+    std::mutex                              writeMutex_;
+    std::vector<std::pair<uint64_t, Map *>> retired_;   // Guarded by writeMutex_
+
+    void reclaim() {
+        auto safe = EpochReclaimer::get().getSafeEpoch();
+        auto it = std::remove_if(retired_.begin(), retired_.end(), [safe](const std::pair<uint64_t, Map *>& retired) {
+            if (retired.first < safe) {
+                delete retired.second;
+                return true;
+            }
+            return false;
+        });
+        retired_.erase(it, retired_.end());
+    }
+};
+
+#endif /* rcuRegistry_h */
@@ -12,9 +12,16 @@
 #include <stdio.h>
 #include "workerPool.h"
 #include "errors.hpp"
+#include "circuitBreaker.hpp"
+#include "fetchTrace.hpp"
+#include "schemeHandler.hpp"
+#include "sessionArchive.hpp"
 
 #include <string>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 class ResourceFetcherService {
 public:
@@ -22,29 +29,70 @@ public:
     ResourceFetcherService(uint32_t numWorkers, uint32_t stress, bool verbose);
 
     // Callback responsible for copying string if needed
-    void add(const std::string& url, std::function<void(Error error, uint32_t statusCode, const std::vector<uint8_t>&)> callback);
+    // The buffer belongs to the request and is discarded after the callback, so the callback may modify it or take it
+    // Note that if the url's scheme handler can complete synchronously, the callback is called before add returns
+    // More urgent priorities are picked off the queue first, and can pause less urgent network transfers already in flight
+    void add(const std::string& url, std::function<void(Error error, uint32_t statusCode, std::vector<uint8_t>&)> callback, FetchPriority priority = FetchPriority::Normal);
+
+    // Scheme is without the "://", eg. "https". Registering an existing scheme replaces the handler
+    void registerSchemeHandler(const std::string& scheme, const std::shared_ptr<SchemeHandler>& handler);
+    std::shared_ptr<SchemeHandler> getSchemeHandler(const std::string& url);
+
+    // Convenience accessors for the built in handlers
+    std::shared_ptr<MemorySchemeHandler> getMemoryHandler() const { return memoryHandler_; }
+    std::shared_ptr<CacheSchemeHandler> getCacheHandler() const { return cacheHandler_; }
+
+    // Circuit breakers are per host and created on demand. Requests to a host whose breaker is open
+    // will fail fast with Error::CircuitOpen
+    std::shared_ptr<CircuitBreaker> getCircuitBreaker(const std::string& host);
+    bool isHostAvailable(const std::string& url);
+
+    // Resolves and connects to each host (eg. http://statsapi.mlb.com) on the worker pool. Connections stay open in
+    // the pooled curl handles, so the first real request to the host can reuse them rather than paying DNS/TCP/TLS
+    void prewarm(const std::vector<std::string>& hostUrls);
+
+    // Timing breakdown of the most recent requests
+    std::shared_ptr<FetchTraceLog> getFetchTrace() const { return trace_; }
+    // In flight network transfers and bytes received per priority
+    std::shared_ptr<TransferScheduler> getTransferScheduler() const { return httpHandler_->getTransferScheduler(); }
+
+    // Every http/https response from this point on is added to the archive. Offsets are relative to the archive's start time
+    void startRecording(const std::shared_ptr<SessionArchive>& archive);
 
 private:
     class Job {
     public:
         Job() {}
-        Job(std::string url, std::function<void(Error error, uint32_t statusCode, const std::vector<uint8_t>&)> cb, uint32_t stress, bool verbose) : verbose_(verbose), stress_(stress), url_(url), callback_(cb) {}
+        Job(std::string url, const std::shared_ptr<SchemeHandler>& handler, std::function<void(Error error, uint32_t statusCode, std::vector<uint8_t>&)> cb, const std::shared_ptr<FetchTraceLog>& trace, const std::shared_ptr<SessionArchive>& recorder, FetchPriority priority, bool prewarm = false) : prewarm_(prewarm), priority_(priority), enqueuedAt_(EpochTime::timeInMicroSec()), url_(url), handler_(handler), callback_(cb), trace_(trace), recorder_(recorder) {}
 
         void execute();
 
     private:
-        bool        verbose_;
-        uint32_t    stress_;
+        bool        prewarm_;
+        FetchPriority priority_;
+        int64_t     enqueuedAt_;    // Microseconds
         std::string url_;
-        std::function<void(Error error, uint32_t statusCode, const std::vector<uint8_t>&)> callback_;
+        std::shared_ptr<SchemeHandler> handler_;
+        std::function<void(Error error, uint32_t statusCode, std::vector<uint8_t>&)> callback_;
+        std::shared_ptr<FetchTraceLog> trace_;
+        std::shared_ptr<SessionArchive> recorder_;
+        FetchTiming timing_;
 
-        static std::size_t curlWriteCallback(const char *in, std::size_t size, std::size_t num, std::vector<uint8_t>* out);
-        std::pair<Error, std::vector<uint8_t>> loadFile();    // Will throw exception on error
-        std::tuple<Error, uint32_t, std::vector<uint8_t>> fetchFile();   // Will throw exception on error
+        void recordTiming(Error error, uint32_t status, size_t bytes);
+        void recordSession(Error error, uint32_t status, std::string headers, const std::vector<uint8_t>& body, int64_t start);
     };
     
     bool            verbose_;
-    uint32_t        stress_;
+
+    std::shared_ptr<HttpSchemeHandler>      httpHandler_;
+    std::shared_ptr<MemorySchemeHandler>    memoryHandler_;
+    std::shared_ptr<CacheSchemeHandler>     cacheHandler_;
+    std::shared_ptr<FetchTraceLog>          trace_;
+    std::shared_ptr<SessionArchive>         recorder_;
+
+    std::mutex                                                      handlersMutex_;
+    std::unordered_map<std::string, std::shared_ptr<SchemeHandler>> handlers_;
+
     WorkerPool<Job> workerPool_;
 };
 
@@ -0,0 +1,566 @@
+//
+//  schemeHandler.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/9/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "schemeHandler.hpp"
+#include "utilities.hpp"
+#include "request.hpp"
+#include "epoch.h"
+#include "logger.hpp"
+#include "curl/curl.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <cstring>
+#include <sys/stat.h>
+
+static const int64_t kDefaultBackoffDuration = 100; // milliseconds
+
+// Circuit breaker tuning. We open after a handful of consecutive failures, stay open for a few seconds, and then
+// let a single probe through to see if the host has recovered
+static const uint32_t kCircuitBreakerFailureThreshold = 5;
+static const int64_t kCircuitBreakerOpenDuration = 5000; // milliseconds
+static const uint32_t kCircuitBreakerMaxProbes = 1;
+
+// Upper bound on how long a single transfer will sit paused for more urgent ones. Keeps it well inside CURLOPT_TIMEOUT
+static const int64_t kMaxTransferPauseDuration = 3000; // milliseconds
+
+// DNS and TLS sessions are shared between all requests. Connections are not, sharing curl's connection cache
+// between threads is not safe, so each easy handle keeps its own and handles are pooled instead. A worker takes a
+// handle, preferably one whose last request was to the same host, and puts it back with its connections still open
+class HttpSchemeHandler::ConnectionShare {
+public:
+    ConnectionShare() : share_(curl_share_init()) {
+        if (share_) {
+            curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, ConnectionShare::lock);
+            curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, ConnectionShare::unlock);
+            curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+    }
+
+    ~ConnectionShare() {
+        // Handles have to go before the share they use
+        for (auto& handle : handles_) {
+            curl_easy_cleanup(handle.curl);
+        }
+        handles_.clear();
+        if (share_) {
+            curl_share_cleanup(share_);
+            share_ = nullptr;
+        }
+    }
+
+    CURLSH *get() const { return share_; }
+
+    // Returns a handle with default options, or nullptr if one could not be created
+    CURL *acquireHandle(const std::string& host) {
+        CURL *curl = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(handlesMutex_);
+            if (!handles_.empty()) {
+                // Most recently used first, it is the most likely to still have a live connection
+                auto it = std::find_if(handles_.rbegin(), handles_.rend(), [&host](const PooledHandle& handle) { return handle.host == host; });
+                auto pos = (it != handles_.rend()) ? std::prev(it.base()) : std::prev(handles_.end());
+                curl = pos->curl;
+                handles_.erase(pos);
+            }
+        }
+        if (curl) {
+            // Clears the options but keeps the connections
+            curl_easy_reset(curl);
+            return curl;
+        }
+        return curl_easy_init();
+    }
+
+    void releaseHandle(CURL *curl, const std::string& host) {
+        std::lock_guard<std::mutex> lock(handlesMutex_);
+        handles_.push_back({ curl, host });
+    }
+
+private:
+    struct PooledHandle {
+        CURL        *curl;
+        std::string host;   // Of the last request, whose connection is probably still open
+    };
+
+    CURLSH                      *share_;
+    std::mutex                  mutexes_[CURL_LOCK_DATA_LAST];
+
+    std::mutex                  handlesMutex_;
+    std::vector<PooledHandle>   handles_;   // Idle, at most one per worker. Most recently released last
+
+    static void lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr) {
+        auto share = static_cast<ConnectionShare *>(userptr);
+        share->mutexes_[data].lock();
+    }
+
+    static void unlock(CURL *handle, curl_lock_data data, void *userptr) {
+        auto share = static_cast<ConnectionShare *>(userptr);
+        share->mutexes_[data].unlock();
+    }
+};
+
+// Options common to all network requests. Connections are only reused by requests whose options match,
+// so prewarming and fetching must go through here
+static void setCommonCurlOptions(CURL *curl, const std::string& url, CURLSH *share) {
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    if (share) {
+        curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    }
+}
+
+static std::atomic<uint64_t> backoffSeed(std::random_device{}());
+
+// Jitter is a function of the seed, the url and the attempt rather than a draw from a shared engine, so the delays a
+// url gets don't depend on what other threads happened to retry in between
+static int64_t getBackoffDuration(int32_t retryCount, const std::string *jitterUrl=nullptr) {
+    auto val = std::exp2(retryCount) * static_cast<double>(kDefaultBackoffDuration);
+    if (jitterUrl) {
+        // FNV-1a over the url, then splitmix64 to spread the bits
+        uint64_t hash = 14695981039346656037ULL;
+        for (auto c : *jitterUrl) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+        }
+        uint64_t x = hash ^ backoffSeed.load() ^ (static_cast<uint64_t>(retryCount) << 56);
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        // Top 53 bits give a uniform double in [0, 1)
+        val *= static_cast<double>(x >> 11) / static_cast<double>(1ULL << 53);
+    }
+    return static_cast<int64_t>(val);
+}
+
+std::string SchemeHandler::getResourcePath(const std::string& url) {
+    auto pos = url.find("://");
+    if (pos == std::string::npos) {
+        return url;
+    }
+    return url.substr(pos + 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  FileSchemeHandler
+//
+////////////////////////////////////////////////////////////////////////////////
+
+std::tuple<Error, uint32_t, std::vector<uint8_t>> FileSchemeHandler::fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) {
+    auto start = EpochTime::timeInMicroSec();
+    auto [error, output] = loadFile(getResourcePath(url));
+    timing.total = static_cast<double>(EpochTime::timeInMicroSec() - start) / 1000000.0;
+    return std::make_tuple(error, 0, std::move(output));
+}
+
+std::pair<Error, std::vector<uint8_t>> FileSchemeHandler::loadFile(const std::string& path) {
+    Error error = Error::None;
+    std::vector<uint8_t> output;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file) {
+        fseek(file, 0L, SEEK_END);
+        auto len = ftell(file);
+        fseek(file, 0L, SEEK_SET);
+
+        output.resize(len);
+        auto bufSize = static_cast<int>(fread(&output[0], sizeof(uint8_t), len, file));
+        if (bufSize != len) {
+            error = Error::IOError;
+            output.clear();
+        }
+        fclose(file);
+    } else {
+        error = Error::NoResource;
+    }
+
+    return std::make_pair(error, std::move(output));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  HttpSchemeHandler
+//
+////////////////////////////////////////////////////////////////////////////////
+
+HttpSchemeHandler::HttpSchemeHandler(uint32_t stress) : stress_(stress) {
+    // curl_easy_init will do this implicitly, but that is not thread safe, so do it before any workers use us
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share_ = std::make_unique<ConnectionShare>();
+    scheduler_ = std::make_shared<TransferScheduler>();
+}
+
+HttpSchemeHandler::~HttpSchemeHandler() {
+    share_ = nullptr;
+    curl_global_cleanup();
+}
+
+std::shared_ptr<CircuitBreaker> HttpSchemeHandler::getCircuitBreaker(const std::string& host) {
+    std::lock_guard<std::mutex> lock(breakersMutex_);
+    auto it = breakers_.find(host);
+    if (it != breakers_.end()) {
+        return it->second;
+    }
+    auto breaker = std::make_shared<CircuitBreaker>(kCircuitBreakerFailureThreshold, kCircuitBreakerOpenDuration, kCircuitBreakerMaxProbes);
+    breakers_[host] = breaker;
+    return breaker;
+}
+
+void HttpSchemeHandler::setBackoffSeed(uint64_t seed) {
+    backoffSeed.store(seed);
+}
+
+std::size_t HttpSchemeHandler::curlHeaderCallback(const char *in, std::size_t size, std::size_t num, std::string* out) {
+    const std::size_t totalBytes(size * num);
+    out->append(in, totalBytes);
+    return totalBytes;
+}
+
+// State for a single curl transfer, shared by the write and progress callbacks
+struct HttpTransfer {
+    CURL                    *curl;
+    std::vector<uint8_t>    *output;
+    TransferScheduler       *scheduler;
+    FetchPriority           priority;
+    bool                    paused;
+    int64_t                 pausedAt;       // Milliseconds
+    int64_t                 pausedTotal;    // Milliseconds
+
+    bool canPause() const {
+        return priority != FetchPriority::High && pausedTotal < kMaxTransferPauseDuration;
+    }
+};
+
+static std::size_t curlWriteCallback(const char *in, std::size_t size, std::size_t num, HttpTransfer* transfer) {
+    if (!transfer->paused && transfer->canPause() && transfer->scheduler->shouldYield(transfer->priority)) {
+        // Nothing is consumed. curl holds on to the data and hands it to us again once we resume
+        transfer->paused = true;
+        transfer->pausedAt = EpochTime::timeInMilliSec();
+        return CURL_WRITEFUNC_PAUSE;
+    }
+    const std::size_t totalBytes(size * num);
+    transfer->output->insert(transfer->output->end(), in, in + totalBytes);
+    transfer->scheduler->addBytes(transfer->priority, totalBytes);
+    return totalBytes;
+}
+
+// While paused, curl still calls this periodically (about once a second when idle), which is where we resume
+static int curlTransferInfoCallback(HttpTransfer* transfer, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+    if (transfer->paused) {
+        auto now = EpochTime::timeInMilliSec();
+        auto pausedFor = now - transfer->pausedAt;
+        if (!transfer->scheduler->shouldYield(transfer->priority) || transfer->pausedTotal + pausedFor >= kMaxTransferPauseDuration) {
+            // Clear paused first, resuming calls the write callback right away
+            transfer->paused = false;
+            transfer->pausedTotal += pausedFor;
+            curl_easy_pause(transfer->curl, CURLPAUSE_CONT);
+        }
+    }
+    return 0;
+}
+
+// A request the breaker let through has to report back, otherwise a half-open breaker runs out of probes and never
+// leaves half-open. Leaving fetch without an outcome (a curl error we don't retry, an exception) counts as a failure
+class BreakerOutcome {
+public:
+    BreakerOutcome(CircuitBreaker& breaker) : breaker_(breaker), recorded_(false) {}
+    ~BreakerOutcome() {
+        if (!recorded_) {
+            breaker_.recordFailure();
+        }
+    }
+
+    void success() {
+        breaker_.recordSuccess();
+        recorded_ = true;
+    }
+
+    void failure() {
+        breaker_.recordFailure();
+        recorded_ = true;
+    }
+
+private:
+    CircuitBreaker& breaker_;
+    bool            recorded_;
+};
+
+std::tuple<Error, uint32_t, std::vector<uint8_t>> HttpSchemeHandler::fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) {
+    Error error = Error::None;
+    uint32_t status = 0;
+    std::vector<uint8_t> output;
+    Request request(url);
+
+    auto host = utilities::getHostFromUrl(url);
+    auto breaker = getCircuitBreaker(host);
+    if (!breaker->allowRequest()) {
+        // Host is considered down, fail fast rather than run through the retry ladder
+        Log(LogLevel::Info) << "Circuit open, skipping " << url;
+        return std::make_tuple(Error::CircuitOpen, status, std::move(output));
+    }
+    BreakerOutcome outcome(*breaker);
+
+    // We do retries with backoff.
+    // However, this is not built overly robust, but is simply an example of plumbing that should be put into place
+    while (true) {
+        CURL *curl = share_->acquireHandle(host);
+        if (!curl) {
+            error = Error::Curl;
+            break;
+        }
+
+        // Right now ignoring any CURLcode return value whereas more robust code should handle errors
+        setCommonCurlOptions(curl, request.url, share_->get());
+
+        // Be sure to clear in case we are retrying
+        output.clear();
+        HttpTransfer transfer{curl, &output, scheduler_.get(), priority, false, 0, 0};
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer);
+        if (transfer.canPause()) {
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, curlTransferInfoCallback);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &transfer);
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+        }
+        if (headers) {
+            headers->clear();
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HttpSchemeHandler::curlHeaderCallback);
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, headers);
+        }
+
+        scheduler_->beginTransfer(priority);
+        auto results = curl_easy_perform(curl);
+        scheduler_->endTransfer(priority);
+        switch (results) {
+        case CURLE_OK:
+            break;
+                
+            // Arbitrary codes selected for retries as illustration of handling different contexts where one needs to treat the error
+            // As something you can retry (like timeout), or an error that is otherwise a failure you can never recover from
+            case CURLE_OPERATION_TIMEDOUT:
+            case CURLE_SEND_ERROR:
+            case CURLE_RECV_ERROR:
+            case CURLE_COULDNT_RESOLVE_PROXY:
+            case CURLE_COULDNT_RESOLVE_HOST:
+            case CURLE_WEIRD_SERVER_REPLY:
+            case CURLE_REMOTE_ACCESS_DENIED:
+            case CURLE_COULDNT_CONNECT:
+            case CURLE_HTTP_RETURNED_ERROR:
+                // This will be a retry
+                break;
+                
+            default:
+                // NOTE: The way this simple error handling is done, actual CURL code is lost
+                // More robust system would either log or surface the actual error
+                error = Error::Curl;
+                break;
+        }
+
+        // Only handle certain errors right now. This is as an illustration of
+        // retry handling. More robust code would handle more cases.
+        long httpCode(0);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &httpCode);
+        // Timing is for the last attempt. Earlier attempts show up as retries
+        curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME, &timing.nameLookup);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &timing.connect);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &timing.appConnect);
+        curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME, &timing.startTransfer);
+        curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME, &timing.total);
+        timing.retries = request.retryCount;
+        share_->releaseHandle(curl, host);
+        
+        status = static_cast<uint32_t>(httpCode);
+        
+        if (error != Error::None) {
+            // On errors, clear
+            output.clear();
+            break;
+        }
+
+        // Server errors and transport failures count against the host. Anything else means the host is alive
+        if (results != CURLE_OK || status >= 500 || status == 0) {
+            outcome.failure();
+        } else {
+            outcome.success();
+        }
+
+        // Right now we only treat certain status codes as candidates for retrying
+        if (status < 500 && status > 0) {
+            // If we get a 200 response, we expect a non-0 output, else we treat that as an error
+            if (status == 200) {
+                if (output.size()) {
+                    break;
+                }
+            } else {
+                break;
+            }
+        }
+        
+        if (breaker->isOpen()) {
+            // Either we or other requests to this host have tripped the breaker, so no point in retrying
+            error = Error::CircuitOpen;
+            output.clear();
+            break;
+        }
+
+        if (request.retryCount < request.maxRetryCounts) {
+            // Jittered so requests that failed together don't retry together. With the same seed a url is always
+            // retried on the same schedule
+            auto backoff = getBackoffDuration(request.retryCount, &url);
+            if (backoff < request.lastBackoffDuration) {
+                backoff += request.lastBackoffDuration;
+            }
+            auto duration = std::chrono::milliseconds(backoff);
+            request.addRetryCountAndSetLastBackoff(backoff);
+            std::this_thread::sleep_for(duration);
+
+            ++request.retryCount;
+        } else {
+            error = Error::HTTPFailed;
+            break;
+        }
+    }
+
+    if (error == Error::None && !output.size()) {
+        error = Error::EmptyResponse;
+    }
+
+    if (stress_) {
+        auto duration = std::chrono::seconds(stress_);
+        std::this_thread::sleep_for(duration);
+    }
+    
+    return std::make_tuple(error, status, std::move(output));
+}
+
+void HttpSchemeHandler::prewarm(const std::string& url) {
+    // A HEAD against the host root gets us DNS, TCP and (for https) TLS. The handle goes back into the pool with
+    // the connection open, where the next request to the host picks it up
+    auto start = EpochTime::timeInMilliSec();
+    auto host = utilities::getHostFromUrl(url);
+    CURL *curl = share_->acquireHandle(host);
+    if (!curl) {
+        return;
+    }
+    setCommonCurlOptions(curl, url, share_->get());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    auto results = curl_easy_perform(curl);
+    share_->releaseHandle(curl, host);
+    Log(LogLevel::Info) << "Prewarmed " << url << " in " << (EpochTime::timeInMilliSec() - start) << "ms" << (results == CURLE_OK ? "" : " (failed)");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  MemorySchemeHandler
+//
+////////////////////////////////////////////////////////////////////////////////
+
+std::tuple<Error, uint32_t, std::vector<uint8_t>> MemorySchemeHandler::fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) {
+    std::shared_ptr<const std::vector<uint8_t>> blob;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = blobs_.find(getResourcePath(url));
+        if (it != blobs_.end()) {
+            blob = it->second;
+        }
+    }
+    if (!blob) {
+        return std::make_tuple(Error::NoResource, 0, std::vector<uint8_t>());
+    }
+    // Copied on purpose. The caller owns the buffer it is handed and may change it (the parsers work in place), and
+    // the blobs are small baked images fetched once each
+    return std::make_tuple(Error::None, 0, *blob);
+}
+
+void MemorySchemeHandler::addBlob(const std::string& name, std::vector<uint8_t> blob) {
+    auto data = std::make_shared<const std::vector<uint8_t>>(std::move(blob));
+    std::lock_guard<std::mutex> lock(mutex_);
+    blobs_[name] = data;
+}
+
+bool MemorySchemeHandler::preloadFile(const std::string& name, const std::string& path) {
+    auto [error, output] = FileSchemeHandler::loadFile(path);
+    if (error != Error::None) {
+        return false;
+    }
+    addBlob(name, std::move(output));
+    return true;
+}
+
+void MemorySchemeHandler::removeBlob(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    blobs_.erase(name);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  CacheSchemeHandler
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CacheSchemeHandler::CacheSchemeHandler(const std::string& directory) : directory_(directory) {
+}
+
+std::tuple<Error, uint32_t, std::vector<uint8_t>> CacheSchemeHandler::fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) {
+    auto path = getPath(getResourcePath(url));
+    if (path.empty()) {
+        return std::make_tuple(Error::NoResourceName, 0, std::vector<uint8_t>());
+    }
+    auto start = EpochTime::timeInMicroSec();
+    auto [error, output] = FileSchemeHandler::loadFile(path);
+    timing.total = static_cast<double>(EpochTime::timeInMicroSec() - start) / 1000000.0;
+    return std::make_tuple(error, 0, std::move(output));
+}
+
+std::string CacheSchemeHandler::getPath(const std::string& name) const {
+    if (name.empty() || name[0] == '/') {
+        return std::string();
+    }
+    // No component may be .., so the path can't climb out of the cache directory
+    size_t start = 0;
+    while (start <= name.size()) {
+        auto end = name.find('/', start);
+        if (end == std::string::npos) {
+            end = name.size();
+        }
+        if (name.compare(start, end - start, "..") == 0) {
+            return std::string();
+        }
+        start = end + 1;
+    }
+    return directory_ + "/" + name;
+}
+
+bool CacheSchemeHandler::store(const std::string& name, const std::vector<uint8_t>& data) {
+    // Ignore the result, most of the time it will already exist
+    mkdir(directory_.c_str(), 0755);
+
+    auto path = getPath(name);
+    if (path.empty()) {
+        return false;
+    }
+    auto tmpPath = path + ".tmp";
+    FILE *file = fopen(tmpPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    auto written = fwrite(data.data(), sizeof(uint8_t), data.size(), file);
+    fclose(file);
+    if (written != data.size() || rename(tmpPath.c_str(), path.c_str())) {
+        remove(tmpPath.c_str());
+        return false;
+    }
+    return true;
+}
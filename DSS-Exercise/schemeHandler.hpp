@@ -0,0 +1,127 @@
+//
+//  schemeHandler.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/9/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef schemeHandler_hpp
+#define schemeHandler_hpp
+
+#include <stdio.h>
+#include "errors.hpp"
+#include "circuitBreaker.hpp"
+#include "fetchTrace.hpp"
+#include "transferScheduler.hpp"
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// A SchemeHandler knows how to get the bytes for urls of a given scheme (eg. file://, https://, mem://).
+// ResourceFetcherService holds a registry of these keyed by scheme.
+class SchemeHandler {
+public:
+    virtual ~SchemeHandler() {}
+
+    // If true, fetch is cheap and does not block (eg. memory resident), so the fetcher runs it inline
+    // on the calling thread instead of hopping to a worker
+    virtual bool canCompleteSynchronously() const =0;
+
+    // Fill in whatever part of timing makes sense for the handler. Handlers which can, use priority to let more urgent
+    // fetches go first. If headers is non-null and the scheme has
+    // response headers, they are returned there as the raw header block. Will throw exception on error
+    virtual std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) =0;
+
+    // Optional. Do whatever is needed to make later fetches to url faster
+    virtual void prewarm(const std::string& url) {}
+
+    // Returns the part of the url after scheme://
+    static std::string getResourcePath(const std::string& url);
+};
+
+// file://
+class FileSchemeHandler : public SchemeHandler {
+public:
+    bool canCompleteSynchronously() const { return false; }
+    std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers);
+
+    static std::pair<Error, std::vector<uint8_t>> loadFile(const std::string& path);
+};
+
+// http:// and https://
+class HttpSchemeHandler : public SchemeHandler {
+public:
+    HttpSchemeHandler() = delete;
+    HttpSchemeHandler(uint32_t stress);
+    ~HttpSchemeHandler();
+
+    bool canCompleteSynchronously() const { return false; }
+    std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers);
+    void prewarm(const std::string& url);
+
+    // Circuit breakers are per host and created on demand. Requests to a host whose breaker is open
+    // will fail fast with Error::CircuitOpen
+    std::shared_ptr<CircuitBreaker> getCircuitBreaker(const std::string& host);
+
+    // Backoff jitter is derived from the seed and the url, so a given seed always retries a url on the same schedule.
+    // Defaults to a random seed
+    static void setBackoffSeed(uint64_t seed);
+
+    // In flight transfers below High priority pause while a more urgent transfer is running
+    std::shared_ptr<TransferScheduler> getTransferScheduler() const { return scheduler_; }
+
+private:
+    // Shared curl state (DNS cache and TLS sessions) used by every request, and the pool of easy handles which
+    // hold the open connections
+    class ConnectionShare;
+
+    uint32_t                            stress_;
+    std::unique_ptr<ConnectionShare>    share_;
+    std::shared_ptr<TransferScheduler>  scheduler_;
+
+    std::mutex                                                          breakersMutex_;
+    std::unordered_map<std::string, std::shared_ptr<CircuitBreaker>>    breakers_;
+
+    static std::size_t curlHeaderCallback(const char *in, std::size_t size, std::size_t num, std::string* out);
+};
+
+// mem:// for blobs which are preloaded or embedded. mem://name returns a copy of the blob registered under name
+class MemorySchemeHandler : public SchemeHandler {
+public:
+    bool canCompleteSynchronously() const { return true; }
+    std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers);
+
+    void addBlob(const std::string& name, std::vector<uint8_t> blob);
+    // Reads the file once and keeps it resident
+    bool preloadFile(const std::string& name, const std::string& path);
+    void removeBlob(const std::string& name);
+
+private:
+    std::mutex                                                                  mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const std::vector<uint8_t>>> blobs_;
+};
+
+// cache:// for things we've persisted ourselves. cache://name maps to a file in the cache directory
+class CacheSchemeHandler : public SchemeHandler {
+public:
+    CacheSchemeHandler() = delete;
+    CacheSchemeHandler(const std::string& directory);
+
+    bool canCompleteSynchronously() const { return false; }
+    std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers);
+
+    // Empty if name is absolute or has a .. component, as it would point outside the cache directory
+    std::string getPath(const std::string& name) const;
+    // Writes to a temporary and then renames so readers never see a partial file
+    bool store(const std::string& name, const std::vector<uint8_t>& data);
+
+private:
+    std::string directory_;
+};
+
+#endif /* schemeHandler_hpp */
@@ -0,0 +1,179 @@
+//
+//  sessionArchive.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/10/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "sessionArchive.hpp"
+#include "epoch.h"
+
+#include <cstring>
+#include <thread>
+
+static const char kSessionArchiveMagic[4] = { 'D', 'S', 'S', 'R' };
+static const uint32_t kSessionArchiveVersion = 1;
+
+template<typename T>
+static void writeValue(FILE *file, T value) {
+    fwrite(&value, sizeof(T), 1, file);
+}
+
+static void writeBytes(FILE *file, const void *data, size_t size) {
+    writeValue<uint32_t>(file, static_cast<uint32_t>(size));
+    if (size) {
+        fwrite(data, 1, size, file);
+    }
+}
+
+template<typename T>
+static bool readValue(FILE *file, T& value) {
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+// Lengths are checked against what's left of the file before anything is allocated, so a corrupt length fails the
+// load rather than asking for up to 4GB
+static bool readLength(FILE *file, long fileSize, uint32_t& size) {
+    if (!readValue(file, size)) {
+        return false;
+    }
+    auto pos = ftell(file);
+    return pos >= 0 && size <= static_cast<unsigned long>(fileSize - pos);
+}
+
+static bool readString(FILE *file, long fileSize, std::string& str) {
+    uint32_t size = 0;
+    if (!readLength(file, fileSize, size)) {
+        return false;
+    }
+    str.resize(size);
+    return !size || fread(&str[0], 1, size, file) == size;
+}
+
+static bool readBytes(FILE *file, long fileSize, std::vector<uint8_t>& bytes) {
+    uint32_t size = 0;
+    if (!readLength(file, fileSize, size)) {
+        return false;
+    }
+    bytes.resize(size);
+    return !size || fread(bytes.data(), 1, size, file) == size;
+}
+
+SessionArchive::SessionArchive() : startTime_(0), seed_(0) {
+}
+
+SessionArchive::SessionArchive(int64_t startTime, uint64_t seed) : startTime_(startTime), seed_(seed) {
+}
+
+size_t SessionArchive::getNumEntries() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void SessionArchive::add(SessionEntry entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    byUrl_[entry.url].push_back(entries_.size());
+    entries_.push_back(std::move(entry));
+}
+
+const SessionEntry* SessionArchive::next(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = byUrl_.find(url);
+    if (it == byUrl_.end()) {
+        return nullptr;
+    }
+    auto& cursor = cursors_[url];
+    auto index = it->second[std::min(cursor, it->second.size() - 1)];
+    ++cursor;
+    // entries_ does not change once we are replaying, so handing out the pointer is safe
+    return &entries_[index];
+}
+
+bool SessionArchive::save(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    fwrite(kSessionArchiveMagic, 1, sizeof(kSessionArchiveMagic), file);
+    writeValue<uint32_t>(file, kSessionArchiveVersion);
+    writeValue<int64_t>(file, startTime_);
+    writeValue<uint64_t>(file, seed_);
+    writeValue<uint32_t>(file, static_cast<uint32_t>(entries_.size()));
+    for (auto& entry : entries_) {
+        writeBytes(file, entry.url.data(), entry.url.size());
+        writeValue<uint32_t>(file, static_cast<uint32_t>(entry.error));
+        writeValue<uint32_t>(file, entry.status);
+        writeValue<int64_t>(file, entry.startOffset);
+        writeValue<int64_t>(file, entry.duration);
+        writeBytes(file, entry.headers.data(), entry.headers.size());
+        writeBytes(file, entry.body.data(), entry.body.size());
+    }
+    bool success = !ferror(file);
+    fclose(file);
+    return success;
+}
+
+bool SessionArchive::load(const std::string& path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    fseek(file, 0L, SEEK_END);
+    auto fileSize = ftell(file);
+    fseek(file, 0L, SEEK_SET);
+
+    char magic[4];
+    uint32_t version = 0;
+    int64_t startTime = 0;
+    uint64_t seed = 0;
+    uint32_t count = 0;
+    bool success = fileSize >= 0 && fread(magic, 1, sizeof(magic), file) == sizeof(magic) && !memcmp(magic, kSessionArchiveMagic, sizeof(magic));
+    success = success && readValue(file, version) && version == kSessionArchiveVersion;
+    success = success && readValue(file, startTime) && readValue(file, seed) && readValue(file, count);
+
+    std::vector<SessionEntry> entries;
+    for (uint32_t i=0;success && i<count;++i) {
+        SessionEntry entry;
+        uint32_t error = 0;
+        success = readString(file, fileSize, entry.url) && readValue(file, error) && readValue(file, entry.status) && readValue(file, entry.startOffset) && readValue(file, entry.duration) && readString(file, fileSize, entry.headers) && readBytes(file, fileSize, entry.body);
+        entry.error = static_cast<Error>(error);
+        entries.push_back(std::move(entry));
+    }
+    fclose(file);
+
+    if (success) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        startTime_ = startTime;
+        seed_ = seed;
+        entries_ = std::move(entries);
+        byUrl_.clear();
+        cursors_.clear();
+        for (size_t i=0;i<entries_.size();++i) {
+            byUrl_[entries_[i].url].push_back(i);
+        }
+    }
+    return success;
+}
+
+ReplaySchemeHandler::ReplaySchemeHandler(const std::shared_ptr<SessionArchive>& archive, double timeScale) : archive_(archive), timeScale_(timeScale) {
+}
+
+std::tuple<Error, uint32_t, std::vector<uint8_t>> ReplaySchemeHandler::fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers) {
+    auto entry = archive_->next(url);
+    if (!entry) {
+        return std::make_tuple(Error::NoResource, 0, std::vector<uint8_t>());
+    }
+
+    auto duration = static_cast<int64_t>(static_cast<double>(entry->duration) * timeScale_);
+    if (duration > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+    }
+    timing.total = static_cast<double>(duration) / 1000.0;
+    if (headers) {
+        *headers = entry->headers;
+    }
+    return std::make_tuple(entry->error, entry->status, entry->body);
+}
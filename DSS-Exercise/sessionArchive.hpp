@@ -0,0 +1,83 @@
+//
+//  sessionArchive.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/10/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef sessionArchive_hpp
+#define sessionArchive_hpp
+
+#include <stdio.h>
+#include "errors.hpp"
+#include "schemeHandler.hpp"
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+// A single network response as ResourceFetcherService saw it
+struct SessionEntry {
+    std::string             url;
+    Error                   error;
+    uint32_t                status;
+    int64_t                 startOffset;    // Milliseconds since the start of the session
+    int64_t                 duration;       // Milliseconds
+    std::string             headers;        // Raw header block
+    std::vector<uint8_t>    body;
+
+    SessionEntry() : error(Error::None), status(0), startOffset(0), duration(0) {}
+};
+
+// Archive of every network response for a session, stored as a single file. Used to record a real session
+// and then replay it without network. Thread safe
+//
+// File format (native endianness):
+//   "DSSR" magic, uint32 version, int64 start time (epoch ms), uint64 backoff seed, uint32 entry count
+//   Per entry: string url, uint32 error, uint32 status, int64 start offset, int64 duration, string headers, bytes body
+//   Strings and bytes are uint32 length prefixed
+class SessionArchive {
+public:
+    SessionArchive();
+    SessionArchive(int64_t startTime, uint64_t seed);
+
+    int64_t getStartTime() const { return startTime_; }
+    uint64_t getSeed() const { return seed_; }
+    size_t getNumEntries();
+
+    void add(SessionEntry entry);
+
+    // Entries for the same url are returned in the order they were recorded. Once we run out, the last one is repeated
+    // Returns nullptr if the url was never recorded
+    const SessionEntry* next(const std::string& url);
+
+    bool save(const std::string& path);
+    bool load(const std::string& path);
+
+private:
+    std::mutex                                              mutex_;
+    int64_t                                                 startTime_;
+    uint64_t                                                seed_;
+    std::vector<SessionEntry>                               entries_;
+    std::unordered_map<std::string, std::vector<size_t>>    byUrl_;
+    std::unordered_map<std::string, size_t>                 cursors_;
+};
+
+// Serves http:// and https:// from a SessionArchive. timeScale scales the recorded duration of each response,
+// 1.0 replays with the original timing, 0 returns responses as fast as possible
+class ReplaySchemeHandler : public SchemeHandler {
+public:
+    ReplaySchemeHandler() = delete;
+    ReplaySchemeHandler(const std::shared_ptr<SessionArchive>& archive, double timeScale);
+
+    bool canCompleteSynchronously() const { return false; }
+    std::tuple<Error, uint32_t, std::vector<uint8_t>> fetch(const std::string& url, FetchPriority priority, FetchTiming& timing, std::string *headers);
+
+private:
+    std::shared_ptr<SessionArchive> archive_;
+    double                          timeScale_;
+};
+
+#endif /* sessionArchive_hpp */
@@ -0,0 +1,201 @@
+//
+//  slotArray.h
+//
+//  Created by Benjamin Lee on 6/18/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef slotArray_h
+#define slotArray_h
+
+#include <stdio.h>
+#include "rcuRegistry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Index into a SlotArray plus the generation of the slot when it was handed out. Once the slot is erased the
+// handle goes stale rather than pointing at whatever reuses the slot. A default constructed handle is null
+struct SlotHandle {
+    uint32_t    index = 0;
+    uint32_t    generation = 0;   // Live generations are odd, so 0 is never live
+
+    explicit operator bool() const { return generation != 0; }
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+
+    // For keeping a handle in a std::atomic<uint64_t>
+    uint64_t pack() const { return (static_cast<uint64_t>(generation) << 32) | index; }
+    static SlotHandle unpack(uint64_t packed) {
+        SlotHandle handle;
+        handle.index = static_cast<uint32_t>(packed);
+        handle.generation = static_cast<uint32_t>(packed >> 32);
+        return handle;
+    }
+};
+
+// Generational slot storage. Lookups by handle are wait-free and never hash or compare strings. Writers are
+// serialized, and reuse erased slots before growing. Slots are allocated in chunks which never move, and an erased
+// value is freed through EpochReclaimer once no reader can still be copying it.
+// Values are returned by copy, so Value is typically a shared_ptr
+template<typename Value>
+class SlotArray {
+public:
+    static constexpr uint32_t kChunkSize = 256;
+    static constexpr uint32_t kMaxChunks = 4096;
+
+    SlotArray() {
+        for (auto& chunk : chunks_) {
+            chunk.store(nullptr);
+        }
+    }
+    // There must be no readers left
+    ~SlotArray() {
+        for (auto& chunk : chunks_) {
+            auto slots = chunk.load();
+            if (slots) {
+                for (uint32_t i=0;i<kChunkSize;++i) {
+                    delete slots[i].value.load();
+                }
+                delete [] slots;
+            }
+        }
+        for (auto& retired : retired_) {
+            delete retired.second;
+        }
+    }
+
+    SlotArray(const SlotArray&) = delete;
+    SlotArray& operator=(const SlotArray&) = delete;
+
+    // Returns a null handle if every slot is in use
+    SlotHandle insert(const Value& value) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        uint32_t index;
+        if (free_.size()) {
+            index = free_.back();
+            free_.pop_back();
+        } else {
+            if (next_ == kChunkSize * kMaxChunks) {
+                return SlotHandle();
+            }
+            index = next_++;
+            auto& chunk = chunks_[index / kChunkSize];
+            if (!chunk.load()) {
+                chunk.store(new Slot[kChunkSize]);
+            }
+        }
+        auto& slot = getSlot(index);
+        slot.value.store(new Value(value));
+        // Live from here on
+        auto generation = slot.generation.load() + 1;
+        slot.generation.store(generation);
+        size_++;
+        SlotHandle handle;
+        handle.index = index;
+        handle.generation = generation;
+        return handle;
+    }
+
+    // Value() if the handle is null or stale
+    Value get(SlotHandle handle) const {
+        if (!handle || handle.index >= kChunkSize * kMaxChunks) {
+            return Value();
+        }
+        auto slots = chunks_[handle.index / kChunkSize].load();
+        if (!slots) {
+            return Value();
+        }
+        auto& slot = slots[handle.index % kChunkSize];
+        EpochReclaimer::ReadGuard guard;
+        if (slot.generation.load() != handle.generation) {
+            return Value();
+        }
+        auto value = slot.value.load();
+        // Erased, and possibly reused, while we were loading
+        if (!value || slot.generation.load() != handle.generation) {
+            return Value();
+        }
+        return *value;
+    }
+
+    bool contains(SlotHandle handle) const {
+        if (!handle || handle.index >= kChunkSize * kMaxChunks) {
+            return false;
+        }
+        auto slots = chunks_[handle.index / kChunkSize].load();
+        return slots && slots[handle.index % kChunkSize].generation.load() == handle.generation;
+    }
+
+    // Returns false if the handle was already stale
+    bool erase(SlotHandle handle) {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (!contains(handle)) {
+            return false;
+        }
+        auto& slot = getSlot(handle.index);
+        // Stale first, so a reader which sees the value gone also sees the generation change
+        slot.generation.store(handle.generation + 1);
+        retired_.emplace_back(EpochReclaimer::get().retire(), slot.value.exchange(nullptr));
+        free_.push_back(handle.index);
+        size_--;
+        reclaim();
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        for (uint32_t index=0;index<next_;++index) {
+            auto& slot = getSlot(index);
+            auto generation = slot.generation.load();
+            if (generation & 1) {
+                slot.generation.store(generation + 1);
+                retired_.emplace_back(EpochReclaimer::get().retire(), slot.value.exchange(nullptr));
+                free_.push_back(index);
+            }
+        }
+        size_ = 0;
+        reclaim();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        return size_;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t>   generation{0};
+        std::atomic<Value *>    value{nullptr};
+    };
+
+    std::atomic<Slot *>                         chunks_[kMaxChunks];
+    mutable std::mutex                          writeMutex_;
+    // Guarded by writeMutex_
+    uint32_t                                    next_ = 0;
+    size_t                                      size_ = 0;
+    std::vector<uint32_t>                       free_;
+    std::vector<std::pair<uint64_t, Value *>>   retired_;
+
+    Slot& getSlot(uint32_t index) {
+        return chunks_[index / kChunkSize].load()[index % kChunkSize];
+    }
+
+    void reclaim() {
+        auto safe = EpochReclaimer::get().getSafeEpoch();
+        auto it = std::remove_if(retired_.begin(), retired_.end(), [safe](const std::pair<uint64_t, Value *>& retired) {
+            if (retired.first < safe) {
+                delete retired.second;
+                return true;
+            }
+            return false;
+        });
+        retired_.erase(it, retired_.end());
+    }
+};
+
+#endif /* slotArray_h */
@@ -10,7 +10,7 @@
 
 #include <SDL2/SDL_image.h>
 
-Texture::Texture(SDL_Texture *texture) : texture_(nullptr), width_(0), height_(0) {
+Texture::Texture(SDL_Texture *texture) : texture_(nullptr), width_(0), height_(0), sourceSize_(0) {
     if (texture) {
         int w = 0;
         int h = 0;
@@ -22,7 +22,7 @@ Texture::Texture(SDL_Texture *texture) : texture_(nullptr), width_(0), height_(0
     }
 }
 
-Texture::Texture(SDL_Renderer* renderer, SDL_Surface *surface, bool destroySurface) : texture_(nullptr), width_(0), height_(0) {
+Texture::Texture(SDL_Renderer* renderer, SDL_Surface *surface, bool destroySurface) : texture_(nullptr), width_(0), height_(0), sourceSize_(0) {
     if (renderer && surface) {
         texture_ = SDL_CreateTextureFromSurface(renderer, surface);
         if (texture_) {
@@ -36,7 +36,7 @@ Texture::Texture(SDL_Renderer* renderer, SDL_Surface *surface, bool destroySurfa
     }
 }
 
-Texture::Texture(SDL_Renderer* renderer, const std::vector<uint8_t>& raw) : texture_(nullptr), width_(0), height_(0) {
+Texture::Texture(SDL_Renderer* renderer, const std::vector<uint8_t>& raw) : texture_(nullptr), width_(0), height_(0), sourceSize_(raw.size()) {
     if (renderer && raw.size()) {
         SDL_RWops *stream = SDL_RWFromConstMem(&raw[0], static_cast<int>(raw.size()));
         if (stream) {
@@ -25,6 +25,8 @@ public:
     inline SDL_Texture *getTexture() const { return texture_; }
     inline uint32_t getWidth() const { return width_; }
     inline uint32_t getHeight() const { return height_; }
+    // Size of the encoded image this was decoded from, 0 if it was not created from one
+    inline size_t getSourceSize() const { return sourceSize_; }
     
     SDL_Rect getRect(int x=0, int y=0) const;
     SDL_Rect getScaledRect(double scaleX, double scaleY, int x=0, int y=0) const;
@@ -37,6 +39,7 @@ private:
     SDL_Texture *texture_;
     uint32_t    width_;
     uint32_t    height_;
+    size_t      sourceSize_;
 };
 
 #endif /* texture_hpp */
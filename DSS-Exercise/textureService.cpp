@@ -7,17 +7,18 @@
 //
 
 #include "textureService.hpp"
+#include "logger.hpp"
 
 TextureService::TextureService(SDL_Renderer *renderer, const    std::shared_ptr<ResourceFetcherService>& fetcher, bool verbose) : renderer_(renderer), fetcher_(fetcher), verbose_(verbose) {
 }
 
 TextureService::~TextureService() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    names_.clear();
     textures_.clear();
     fetcher_ = nullptr;
 }
 
-void TextureService::createTexture(const std::string& name, const std::string& url, std::function<void(Error, std::shared_ptr<Texture>)> callback) {
+void TextureService::createTexture(const std::string& name, const std::string& url, std::function<void(Error, std::shared_ptr<Texture>)> callback, FetchPriority priority) {
     auto existing = getTexture(name);
     if (existing) {
         if (callback) {
@@ -26,64 +27,136 @@ void TextureService::createTexture(const std::string& name, const std::string& u
     } else {
         // Make local copy to capture
         std::string textName = name;
-        fetcher_->add(url, [this, textName, callback](Error error, uint32_t status, const std::vector<uint8_t> buffer) {
-            std::shared_ptr<Texture> texture;
-            if (error == Error::None) {
-                texture = std::make_shared<Texture>(renderer_, buffer);
-                // Now double check that the texture has an actual SDL texture
-                if (texture && texture->isValid()) {
-                    std::unique_lock<std::mutex> lock(mutex_);
-                    textures_[textName] = texture;
-                } else {
-                    error = Error::CouldNotCreateResource;
+        loadTexture(url, [this, textName, callback](Error error, TextureHandle handle, std::shared_ptr<Texture> texture) {
+            if (handle) {
+                auto named = addName(textName, handle);
+                if (named != handle) {
+                    // Another load of the same name finished first
+                    texture = getTexture(named);
                 }
             }
-            
             if (callback) {
                 callback(error, texture);
             }
-        });
+        }, priority, name);
     }
 }
 
 std::shared_ptr<Texture>  TextureService::createTexture(const std::string& name, SDL_Surface *surface, bool destroySurface) {
     auto existing = getTexture(name);
     if (existing) {
+        if (surface && destroySurface) {
+            SDL_FreeSurface(surface);
+        }
         return existing;
-    } else if (surface) {
+    }
+    auto handle = createTexture(surface, destroySurface, name);
+    if (handle) {
+        handle = addName(name, handle);
+    }
+    return getTexture(handle);
+}
+
+void TextureService::loadTexture(const std::string& url, std::function<void(Error, TextureHandle, std::shared_ptr<Texture>)> callback, FetchPriority priority, const std::string& name) {
+    // Make local copy to capture
+    std::string textName = name;
+    fetcher_->add(url, [this, textName, callback](Error error, uint32_t status, const std::vector<uint8_t>& buffer) {
+        std::shared_ptr<Texture> texture;
+        TextureHandle handle;
+        if (error == Error::None) {
+            texture = std::make_shared<Texture>(renderer_, buffer);
+            // Now double check that the texture has an actual SDL texture
+            if (texture && texture->isValid()) {
+                handle = addTexture(texture, textName);
+            }
+            if (!handle) {
+                error = Error::CouldNotCreateResource;
+            }
+        }
+        
+        if (callback) {
+            callback(error, handle, texture);
+        }
+    }, priority);
+}
+
+TextureHandle TextureService::createTexture(SDL_Surface *surface, bool destroySurface, const std::string& name) {
+    if (surface) {
         auto texture = std::make_shared<Texture>(renderer_, surface, destroySurface);
         if (texture && texture->isValid()) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            textures_[name] = texture;
-            return texture;
+            return addTexture(texture, name);
         }
     }
-    return nullptr;
+    return TextureHandle();
+}
+
+std::shared_ptr<Texture> TextureService::getTexture(TextureHandle handle) {
+    return textures_.get(handle);
 }
 
 std::shared_ptr<Texture> TextureService::getTexture(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = textures_.find(name);
-    if (it != textures_.end()) {
-        return it->second;
+    return textures_.get(names_.find(name));
+}
+
+TextureHandle TextureService::findTexture(const std::string& name) {
+    return names_.find(name);
+}
+
+void TextureService::removeTexture(TextureHandle handle) {
+    if (textures_.erase(handle) && verbose_) {
+        std::lock_guard<std::mutex> lock(debugMutex_);
+        auto it = debugNames_.find(handle.index);
+        // The slot may already have been reused
+        if (it != debugNames_.end() && it->second.first == handle.generation) {
+            debugNames_.erase(it);
+        }
     }
-    return nullptr;
 }
 
 void TextureService::removeTexture(const std::string& name) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    auto it = textures_.find(name);
-    if (it != textures_.end()) {
-        textures_.erase(name);
+    auto handle = names_.find(name);
+    if (handle) {
+        names_.erase(name);
+        removeTexture(handle);
     }
 }
 
-void TextureService::removeTexture(const std::shared_ptr<Texture>& texture) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto it : textures_) {
-        if (it.second == texture) {
-            textures_.erase(it.first);
-            return;
+std::string TextureService::getName(TextureHandle handle) {
+    if (textures_.contains(handle)) {
+        std::lock_guard<std::mutex> lock(debugMutex_);
+        auto it = debugNames_.find(handle.index);
+        if (it != debugNames_.end() && it->second.first == handle.generation) {
+            return it->second.second;
         }
     }
+    return std::string();
+}
+
+TextureHandle TextureService::addName(const std::string& name, TextureHandle handle) {
+    // Checked and inserted in one write, as two creates of the same name can race to get here
+    TextureHandle named = handle;
+    names_.update([this, &name, &named](RcuRegistry<std::string, TextureHandle>::Map& map) {
+        auto it = map.find(name);
+        if (it != map.end() && textures_.contains(it->second)) {
+            named = it->second;
+            return false;
+        }
+        map[name] = named;
+        return true;
+    });
+    if (named != handle) {
+        removeTexture(handle);
+    }
+    return named;
+}
+
+TextureHandle TextureService::addTexture(const std::shared_ptr<Texture>& texture, const std::string& name) {
+    auto handle = textures_.insert(texture);
+    if (!handle) {
+        Log(LogLevel::Error) << "Out of texture slots";
+    } else if (verbose_ && name.size()) {
+        std::lock_guard<std::mutex> lock(debugMutex_);
+        debugNames_[handle.index] = std::make_pair(handle.generation, name);
+    }
+    return handle;
 }
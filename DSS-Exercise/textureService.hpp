@@ -13,6 +13,8 @@
 #include "texture.hpp"
 #include "errors.hpp"
 #include "resourceFetcherService.hpp"
+#include "rcuRegistry.h"
+#include "slotArray.h"
 #include <SDL2/SDL.h>
 
 #include <memory>
@@ -20,26 +22,47 @@
 #include <mutex>
 #include <unordered_map>
 
+using TextureHandle = SlotHandle;
+
+// Textures live in slots and are referred to by TextureHandle, so the lookups made every frame are an index and
+// a generation check rather than building and hashing a string. Textures which have to be found by name, eg. the
+// baked in images, also have their name interned. Names are otherwise only kept for debugging
 class TextureService {
 public:
     TextureService() = delete;
     TextureService(SDL_Renderer *renderer, const std::shared_ptr<ResourceFetcherService>& fetcher, bool verbose);
     ~TextureService();
     
-    void createTexture(const std::string& name, const std::string& url, std::function<void(Error, std::shared_ptr<Texture>)> callback);
+    // Named
+    void createTexture(const std::string& name, const std::string& url, std::function<void(Error, std::shared_ptr<Texture>)> callback, FetchPriority priority = FetchPriority::Normal);
     std::shared_ptr<Texture> createTexture(const std::string& name, SDL_Surface *surface, bool destroySurface);
+    // Anonymous, whoever holds the handle is responsible for removing it. name is only for debugging
+    void loadTexture(const std::string& url, std::function<void(Error, TextureHandle, std::shared_ptr<Texture>)> callback, FetchPriority priority = FetchPriority::Normal, const std::string& name = std::string());
+    TextureHandle createTexture(SDL_Surface *surface, bool destroySurface, const std::string& name = std::string());
 
+    // Wait-free, so the render thread is never held up by workers adding textures
+    std::shared_ptr<Texture> getTexture(TextureHandle handle);
     std::shared_ptr<Texture> getTexture(const std::string& name);
+    TextureHandle findTexture(const std::string& name);
+    void removeTexture(TextureHandle handle);
     void removeTexture(const std::string& name);
-    void removeTexture(const std::shared_ptr<Texture>& texture);
+
+    std::string getName(TextureHandle handle);
+    size_t getNumTextures() const { return textures_.size(); }
     
 private:
     bool                                    verbose_;
     SDL_Renderer                            *renderer_;
     std::shared_ptr<ResourceFetcherService> fetcher_;
     
-    std::mutex                              mutex_;
-    std::unordered_map<std::string, std::shared_ptr<Texture>>   textures_;
+    SlotArray<std::shared_ptr<Texture>>         textures_;
+    RcuRegistry<std::string, TextureHandle>     names_;         // Interned names of named textures
+    std::mutex                                  debugMutex_;
+    std::unordered_map<uint32_t, std::pair<uint32_t, std::string>> debugNames_;  // Generation and name by slot index, verbose only
+
+    TextureHandle addTexture(const std::shared_ptr<Texture>& texture, const std::string& name);
+    // Names handle unless name already has a live texture, in which case handle is removed. Returns the named one
+    TextureHandle addName(const std::string& name, TextureHandle handle);
 };
 
 #endif /* textureService_hpp */
@@ -8,5 +8,5 @@
 
 #include "thumbnail.hpp"
 
-Thumbnail::Thumbnail(const std::shared_ptr<FeedGameRecap>& recap, int width, int height) : recap(recap), x(0), y(0), width(width), height(height), scale(1), alpha(255) {
+Thumbnail::Thumbnail(const std::shared_ptr<FeedGameRecap>& recap, int width, int height) : recap(recap), x(0), y(0), width(width), height(height), scale(1), alpha(255), hasText(false), hasFocus(false) {
 }
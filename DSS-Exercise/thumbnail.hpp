@@ -33,9 +33,13 @@ struct Thumbnail {
     double                          scale;
     uint8_t                         alpha;
     
+    // Only set while the thumbnail is near the focused one, see hasText
     std::shared_ptr<Texture>        headline;
     std::shared_ptr<Texture>        description;
     std::shared_ptr<Texture>        thumb;
+    std::shared_ptr<Texture>        focusThumb;     // Larger cut, only while focused, see hasFocus
+    bool                            hasText;
+    bool                            hasFocus;
     
     Thumbnail(const std::shared_ptr<FeedGameRecap>& recap, int width, int height);
 };
@@ -0,0 +1,85 @@
+//
+//  transferScheduler.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/10/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#include "transferScheduler.hpp"
+
+TransferScheduler::TransferScheduler() {
+    for (size_t i=0;i<kNumPriorities;++i) {
+        active_[i] = 0;
+        bytes_[i] = 0;
+        contendedBytes_[i] = 0;
+    }
+}
+
+void TransferScheduler::beginTransfer(FetchPriority priority) {
+    ++active_[static_cast<size_t>(priority)];
+}
+
+void TransferScheduler::endTransfer(FetchPriority priority) {
+    --active_[static_cast<size_t>(priority)];
+}
+
+bool TransferScheduler::shouldYield(FetchPriority priority) const {
+    for (size_t i=0;i<static_cast<size_t>(priority);++i) {
+        if (active_[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TransferScheduler::isContended() const {
+    size_t numActive = 0;
+    for (size_t i=0;i<kNumPriorities;++i) {
+        if (active_[i]) {
+            ++numActive;
+        }
+    }
+    return numActive > 1;
+}
+
+void TransferScheduler::addBytes(FetchPriority priority, uint64_t bytes) {
+    auto index = static_cast<size_t>(priority);
+    bytes_[index] += bytes;
+    if (isContended()) {
+        contendedBytes_[index] += bytes;
+    }
+}
+
+std::vector<TransferScheduler::BandwidthShare> TransferScheduler::getBandwidthShares() const {
+    std::vector<BandwidthShare> shares;
+    uint64_t totalContended = 0;
+    for (size_t i=0;i<kNumPriorities;++i) {
+        BandwidthShare share;
+        share.priority = static_cast<FetchPriority>(i);
+        share.bytes = bytes_[i];
+        share.contendedBytes = contendedBytes_[i];
+        share.contendedShare = 0;
+        totalContended += share.contendedBytes;
+        shares.push_back(share);
+    }
+    if (totalContended) {
+        for (auto& share : shares) {
+            share.contendedShare = static_cast<double>(share.contendedBytes) / static_cast<double>(totalContended);
+        }
+    }
+    return shares;
+}
+
+const char *TransferScheduler::getPriorityName(FetchPriority priority) {
+    switch (priority) {
+        case FetchPriority::High:
+            return "high";
+        case FetchPriority::Normal:
+            return "normal";
+        case FetchPriority::Prefetch:
+            return "prefetch";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,59 @@
+//
+//  transferScheduler.hpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/10/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+
+#ifndef transferScheduler_hpp
+#define transferScheduler_hpp
+
+#include <stdio.h>
+#include <cstdint>
+#include <atomic>
+#include <vector>
+
+// Most urgent first
+enum class FetchPriority : uint32_t {
+    High = 0,       // Something the user is waiting on, eg. the feed or a visible thumbnail
+    Normal,
+    Prefetch,       // Nice to have, can wait
+    Count
+};
+
+// Tracks in flight network transfers by priority so lower priority transfers can get out of the way of more urgent ones.
+// Also keeps a tally of bytes received per priority. Thread safe
+class TransferScheduler {
+public:
+    struct BandwidthShare {
+        FetchPriority   priority;
+        uint64_t        bytes;
+        uint64_t        contendedBytes;     // Received while transfers of more than one priority were in flight
+        double          contendedShare;     // Fraction of all contended bytes
+    };
+
+    TransferScheduler();
+
+    void beginTransfer(FetchPriority priority);
+    void endTransfer(FetchPriority priority);
+
+    // True if a more urgent transfer is in flight
+    bool shouldYield(FetchPriority priority) const;
+
+    void addBytes(FetchPriority priority, uint64_t bytes);
+    std::vector<BandwidthShare> getBandwidthShares() const;
+
+    static const char *getPriorityName(FetchPriority priority);
+
+private:
+    static const size_t kNumPriorities = static_cast<size_t>(FetchPriority::Count);
+
+    std::atomic<uint32_t>   active_[kNumPriorities];
+    std::atomic<uint64_t>   bytes_[kNumPriorities];
+    std::atomic<uint64_t>   contendedBytes_[kNumPriorities];
+
+    bool isContended() const;
+};
+
+#endif /* transferScheduler_hpp */
@@ -36,6 +36,19 @@ bool utilities::isPrefixOf(const std::string& str, const std::string& prefix) {
     return is;
 }
 
+std::string utilities::getHostFromUrl(const std::string& url) {
+    auto start = url.find("://");
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    start += 3;
+    auto end = url.find_first_of(":/?#", start);
+    if (end == std::string::npos) {
+        end = url.size();
+    }
+    return url.substr(start, end - start);
+}
+
 SDL_Rect utilities::getPosition(const std::shared_ptr<Texture>& texture, int x, int y) {
     return SDL_Rect{ x, y, static_cast<int>(texture->getWidth()), static_cast<int>(texture->getHeight()) };
 }
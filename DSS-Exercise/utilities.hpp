@@ -22,6 +22,9 @@ namespace utilities {
 void componentsSeparatedByDelimiter(const std::string& str, char delim, std::vector<std::string>& components);
 bool isPrefixOf(const std::string& str, const std::string& prefix);
 
+// Returns the host portion of a url (eg. http://statsapi.mlb.com/api/v1 returns statsapi.mlb.com). Returns empty string if there is no scheme
+std::string getHostFromUrl(const std::string& url);
+
 // Default anchor is upper left, however at times, it's easier to use center anchor == (0.5, 0.5)
 SDL_Rect getPosition(const std::shared_ptr<Texture>& texture, int x, int y);
 SDL_Rect getPosition(const std::shared_ptr<Texture>& texture, int x, int y, double anchorX, double anchorY);
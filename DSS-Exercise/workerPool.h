@@ -11,7 +11,8 @@
 #include "epoch.h"
 
 #include <stdio.h>
-#include <queue>
+#include <vector>
+#include <algorithm>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -39,8 +40,9 @@ public:
         }
     }
     
-    void add(const U& task);
-    void add(U&& task);
+    // Tasks with a higher priority run first. Tasks of equal priority run in the order they were added
+    void add(const U& task, int32_t priority = 0);
+    void add(U&& task, int32_t priority = 0);
     
     size_t  maxDepth() const { return maxDepth_; }
     std::vector<WorkerPoolWorker<U>>& getPoolWorkerObjects() { return poolWorkersObjects_; }
@@ -54,11 +56,31 @@ private:
     
     size_t                      maxDepth_;
     
-    std::queue<U>               queue_;
+    struct Entry {
+        int32_t     priority;
+        uint64_t    sequence;
+        U           task;
+    };
+
+    // Orders the heap so the highest priority, then oldest, entry is on top
+    struct EntryCompare {
+        bool operator()(const Entry& a, const Entry& b) const {
+            if (a.priority != b.priority) {
+                return a.priority < b.priority;
+            }
+            return a.sequence > b.sequence;
+        }
+    };
+
+    uint64_t                    sequence_;
+    std::vector<Entry>          queue_;     // Heap ordered by EntryCompare
     std::mutex                  mutex_;
     std::condition_variable     cond_;
     
     bool                        running_;
+
+    void push(Entry&& entry);
+    U pop();
 };
 
 template<typename U>
@@ -102,7 +124,7 @@ private:
 ////////////////////////////////////////////////////////////////////////////////
 
 template<typename U>
-WorkerPool<U>::WorkerPool(size_t numWorkers) : numWorkers_(numWorkers), maxDepth_(0), running_(true) {
+WorkerPool<U>::WorkerPool(size_t numWorkers) : numWorkers_(numWorkers), maxDepth_(0), sequence_(0), running_(true) {
 }
 
 template<typename U>
@@ -121,9 +143,9 @@ WorkerPool<U>::~WorkerPool() {
 }
 
 template<typename U>
-void WorkerPool<U>::add(const U& task) {
+void WorkerPool<U>::add(const U& task, int32_t priority) {
     std::unique_lock<std::mutex> mlock(mutex_);
-    queue_.push(std::move(task));
+    push(Entry{priority, sequence_++, task});
     if (queue_.size() > maxDepth_) {
         maxDepth_ = queue_.size();
     }
@@ -132,9 +154,9 @@ void WorkerPool<U>::add(const U& task) {
 }
 
 template<typename U>
-void WorkerPool<U>::add(U&& task) {
+void WorkerPool<U>::add(U&& task, int32_t priority) {
     std::unique_lock<std::mutex> mlock(mutex_);
-    queue_.push(std::move(task));
+    push(Entry{priority, sequence_++, std::move(task)});
     if (queue_.size() > maxDepth_) {
         maxDepth_ = queue_.size();
     }
@@ -142,6 +164,21 @@ void WorkerPool<U>::add(U&& task) {
     cond_.notify_one();
 }
 
+// Both of these expect mutex_ to be held
+template<typename U>
+void WorkerPool<U>::push(Entry&& entry) {
+    queue_.push_back(std::move(entry));
+    std::push_heap(queue_.begin(), queue_.end(), EntryCompare());
+}
+
+template<typename U>
+U WorkerPool<U>::pop() {
+    std::pop_heap(queue_.begin(), queue_.end(), EntryCompare());
+    U task = std::move(queue_.back().task);
+    queue_.pop_back();
+    return task;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 //  WorkerPoolWorker
@@ -175,8 +212,7 @@ void WorkerPoolWorker<U>::operator()() {
             }
             
             if (running) {
-                task = std::move(queue.front());
-                queue.pop();
+                task = pool_.pop();
             } else {
                 return;
             }
@@ -0,0 +1,132 @@
+//
+//  rcuRegistryStress.cpp
+//  DSS-Exercise
+//
+//  Created by Benjamin Lee on 6/16/22.
+//  Copyright © 2022 Benjamin Lee. All rights reserved.
+//
+//  Standalone stress test for RcuRegistry and EpochReclaimer. Readers look values up while writers insert, replace
+//  and erase them, and every value read is checked to still be intact. More reader threads are started than
+//  EpochReclaimer has slots, so the shared overflow counter is exercised as well. Meant to be run under the
+//  sanitizers, which catch a map or value freed while a reader can still see it:
+//
+//      c++ -std=c++17 -O1 -g -fsanitize=thread -I DSS-Exercise Tests/rcuRegistryStress.cpp -o rcuStress && ./rcuStress
+//      c++ -std=c++17 -O1 -g -fsanitize=address -I DSS-Exercise Tests/rcuRegistryStress.cpp -o rcuStress && ./rcuStress
+//
+
+#include "rcuRegistry.h"
+
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+static const uint32_t kMagic = 0x5AFEF00D;
+static const int kNumKeys = 64;
+static const int kNumWriters = 4;
+static const int kNumReaders = EpochReclaimer::kMaxThreads + 32;
+static const int kWritesPerWriter = 2000;
+
+static std::atomic<int64_t> liveValues{0};
+
+struct Value {
+    int         key;
+    uint32_t    magic;
+
+    Value(int key) : key(key), magic(kMagic) { ++liveValues; }
+    ~Value() { magic = 0; --liveValues; }
+};
+
+int main(int argc, const char *argv[]) {
+    std::atomic<bool> failed{false};
+    std::atomic<bool> writing{true};
+    std::atomic<int> started{0};
+    std::atomic<uint64_t> reads{0};
+    {
+        RcuRegistry<int, std::shared_ptr<Value>> registry;
+        for (int key=0;key<kNumKeys;++key) {
+            registry.insert(key, std::make_shared<Value>(key));
+        }
+
+        std::vector<std::thread> threads;
+        for (int i=0;i<kNumReaders;++i) {
+            threads.emplace_back([&registry, &failed, &writing, &started, &reads, i]() {
+                uint64_t count = 0;
+                // Every reader holds its epoch slot, or its place in the overflow count, until they have all started
+                registry.find(0);
+                ++started;
+                while (started.load() < kNumReaders) {
+                    std::this_thread::yield();
+                }
+                int key = i % kNumKeys;
+                do {
+                    key = (key + 1) % kNumKeys;
+                    auto value = registry.find(key);
+                    if (value && (value->key != key || value->magic != kMagic)) {
+                        failed = true;
+                    }
+                    registry.forEach([&failed](const int& key, const std::shared_ptr<Value>& value) {
+                        if (!value || value->key != key || value->magic != kMagic) {
+                            failed = true;
+                        }
+                    });
+                    ++count;
+                } while (writing.load());
+                reads += count;
+            });
+        }
+        // Overlap the readers with the writers so some of them are in the overflow path while maps are retired
+        while (started.load() < kNumReaders / 2) {
+            std::this_thread::yield();
+        }
+
+        std::vector<std::thread> writers;
+        for (int i=0;i<kNumWriters;++i) {
+            writers.emplace_back([&registry, i]() {
+                std::mt19937 random(i);
+                std::uniform_int_distribution<int> keys(0, kNumKeys - 1);
+                for (int n=0;n<kWritesPerWriter;++n) {
+                    auto key = keys(random);
+                    switch (n % 3) {
+                        case 0:
+                            registry.insert(key, std::make_shared<Value>(key));
+                            break;
+                        case 1:
+                            registry.erase(key);
+                            break;
+                        default:
+                            registry.update([key](RcuRegistry<int, std::shared_ptr<Value>>::Map& map) {
+                                map[key] = std::make_shared<Value>(key);
+                                return true;
+                            });
+                            break;
+                    }
+                }
+            });
+        }
+        for (auto& writer : writers) {
+            writer.join();
+        }
+        writing = false;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        // With every reader gone the next write can reclaim everything retired so far
+        registry.clear();
+        if (EpochReclaimer::get().getSafeEpoch() == 0) {
+            std::cerr << "Overflow readers were not all accounted for" << std::endl;
+            failed = true;
+        }
+    }
+    if (liveValues.load() != 0) {
+        std::cerr << liveValues.load() << " values leaked" << std::endl;
+        failed = true;
+    }
+    if (failed.load()) {
+        std::cerr << "FAILED" << std::endl;
+        return 1;
+    }
+    std::cout << "OK, " << reads.load() << " reads by " << kNumReaders << " readers against " << kNumWriters * kWritesPerWriter << " writes" << std::endl;
+    return 0;
+}